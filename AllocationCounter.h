@@ -0,0 +1,5 @@
+#pragma once
+
+// Number of times the program called the global operator new, so a step can be checked for heap
+// allocations by comparing the count before and after it. Memory raylib takes with malloc is not seen.
+unsigned long long heapAllocationCount();
@@ -0,0 +1,422 @@
+#include "ArrowWriter.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+
+// Arrow metadata constants, see format/Schema.fbs and format/Message.fbs in the Arrow repository
+static const unsigned long long metadataVersion = 4;
+static const unsigned long long schemaHeader = 1;
+static const unsigned long long recordBatchHeader = 3;
+static const unsigned long long intType = 2;
+static const unsigned long long floatingPointType = 3;
+static const unsigned long long singlePrecision = 1;
+static const unsigned long long lz4FrameCodec = 0;
+static const unsigned long long bufferCompression = 0;
+
+static const int lz4HashBits = 12;
+static const int lz4MaxBlock = 4 << 20;
+
+struct FlatField {
+	int id{};
+	int size{};
+	unsigned long long value{};
+};
+
+// Writes a flatbuffer front to back. Every object is written before the objects it refers to,
+// so offsets always point forward as flatbuffers requires, and are filled in with point().
+class FlatBuilder
+{
+public:
+	std::vector<unsigned char>& data;
+
+	explicit FlatBuilder(std::vector<unsigned char>& out) : data{ out }
+	{
+		data.clear();
+	}
+
+	void align(size_t alignment)
+	{
+		data.resize((data.size() + alignment - 1) / alignment * alignment, 0);
+	}
+
+	size_t scalar(const void* value, size_t size)
+	{
+		align(size);
+		const size_t at = data.size();
+		data.resize(at + size);
+		std::memcpy(data.data() + at, value, size);
+		return at;
+	}
+
+	size_t offsetSlot()
+	{
+		const unsigned zero = 0;
+		return scalar(&zero, sizeof(zero));
+	}
+
+	void point(size_t slot, size_t target)
+	{
+		const unsigned offset = static_cast<unsigned>(target - slot);
+		std::memcpy(data.data() + slot, &offset, sizeof(offset));
+	}
+
+	// Offset fields have size 0, their slots are returned in field order
+	size_t table(std::initializer_list<FlatField> fields, std::vector<size_t>& slots)
+	{
+		int fieldCount = 0;
+		for (const FlatField& field : fields)
+			fieldCount = std::max(fieldCount, field.id + 1);
+
+		// Widest fields first so every field is naturally aligned
+		std::vector<const FlatField*> order;
+		for (const FlatField& field : fields)
+			order.push_back(&field);
+		std::stable_sort(order.begin(), order.end(), [](const FlatField* a, const FlatField* b) { return (a->size ? a->size : 4) > (b->size ? b->size : 4); });
+		std::vector<unsigned short> fieldOffsets(fieldCount, 0);
+		unsigned short tableSize = 4;
+		for (const FlatField* field : order)
+		{
+			const unsigned short width = static_cast<unsigned short>(field->size ? field->size : 4);
+			tableSize = (tableSize + width - 1) / width * width;
+			fieldOffsets[field->id] = tableSize;
+			tableSize += width;
+		}
+
+		const unsigned short vtableSize = static_cast<unsigned short>(4 + 2 * fieldCount);
+		const size_t vtable = scalar(&vtableSize, sizeof(vtableSize));
+		scalar(&tableSize, sizeof(tableSize));
+		for (unsigned short fieldOffset : fieldOffsets)
+			scalar(&fieldOffset, sizeof(fieldOffset));
+
+		align(8);
+		const size_t table = data.size();
+		data.resize(table + tableSize, 0);
+		const int vtableOffset = static_cast<int>(table - vtable);
+		std::memcpy(data.data() + table, &vtableOffset, sizeof(vtableOffset));
+		for (const FlatField& field : fields)
+		{
+			if (field.size)
+				std::memcpy(data.data() + table + fieldOffsets[field.id], &field.value, field.size);
+			else
+				slots.push_back(table + fieldOffsets[field.id]);
+		}
+		return table;
+	}
+
+	size_t string(const std::string& text)
+	{
+		const unsigned length = static_cast<unsigned>(text.size());
+		const size_t at = scalar(&length, sizeof(length));
+		data.insert(data.end(), text.begin(), text.end());
+		data.push_back(0);
+		return at;
+	}
+
+	// Slots of the elements follow the length, 4 bytes apart
+	size_t offsetVector(int count)
+	{
+		const unsigned length = static_cast<unsigned>(count);
+		const size_t at = scalar(&length, sizeof(length));
+		data.resize(data.size() + 4 * count, 0);
+		return at;
+	}
+
+	size_t structVector(const void* elements, int count, size_t elementSize)
+	{
+		// Elements start 8 byte aligned, right after the length
+		align(4);
+		if ((data.size() + 4) % 8 != 0)
+			data.resize(data.size() + 4, 0);
+		const unsigned length = static_cast<unsigned>(count);
+		const size_t at = scalar(&length, sizeof(length));
+		const unsigned char* bytes = static_cast<const unsigned char*>(elements);
+		data.insert(data.end(), bytes, bytes + count * elementSize);
+		return at;
+	}
+};
+
+static unsigned rotateLeft(unsigned value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+// xxHash32 for inputs under 16 bytes, only needed for the LZ4 frame header checksum
+static unsigned xxHash32(const unsigned char* bytes, size_t size)
+{
+	const unsigned prime1 = 2654435761u, prime2 = 2246822519u, prime3 = 3266489917u, prime4 = 668265263u, prime5 = 374761393u;
+	unsigned hash = prime5 + static_cast<unsigned>(size);
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4)
+	{
+		unsigned word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = rotateLeft(hash + word * prime3, 17) * prime4;
+	}
+	for (; i < size; i++)
+		hash = rotateLeft(hash + bytes[i] * prime5, 11) * prime1;
+	hash ^= hash >> 15;
+	hash *= prime2;
+	hash ^= hash >> 13;
+	hash *= prime3;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static void lz4Length(std::vector<unsigned char>& out, int length)
+{
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+	out.push_back(static_cast<unsigned char>(length));
+}
+
+static void lz4Sequence(std::vector<unsigned char>& out, const unsigned char* literals, int literalLength, int offset, int matchLength)
+{
+	const int matchCode = matchLength - 4;
+	out.push_back(static_cast<unsigned char>((std::min(literalLength, 15) << 4) | (matchLength > 0 ? std::min(matchCode, 15) : 0)));
+	if (literalLength >= 15)
+		lz4Length(out, literalLength - 15);
+	out.insert(out.end(), literals, literals + literalLength);
+	if (matchLength == 0)
+		return;
+	out.push_back(static_cast<unsigned char>(offset));
+	out.push_back(static_cast<unsigned char>(offset >> 8));
+	if (matchCode >= 15)
+		lz4Length(out, matchCode - 15);
+}
+
+// Greedy LZ4 block compression with a single hash table probe per position. The format wants the
+// last 5 bytes as literals and no match starting in the last 12.
+static void lz4Block(const unsigned char* source, int size, std::vector<unsigned char>& out, std::vector<int>& hashTable)
+{
+	hashTable.assign(1 << lz4HashBits, -1);
+	int anchor = 0;
+	int i = 0;
+	while (i < size - 12)
+	{
+		unsigned sequence;
+		std::memcpy(&sequence, source + i, sizeof(sequence));
+		const unsigned hash = (sequence * 2654435761u) >> (32 - lz4HashBits);
+		const int candidate = hashTable[hash];
+		hashTable[hash] = i;
+		if (candidate < 0 || i - candidate > 65535 || std::memcmp(source + candidate, source + i, 4) != 0)
+		{
+			i++;
+			continue;
+		}
+		int matchLength = 4;
+		while (i + matchLength < size - 5 && source[candidate + matchLength] == source[i + matchLength])
+			matchLength++;
+		lz4Sequence(out, source + anchor, i - anchor, i - candidate, matchLength);
+		i += matchLength;
+		anchor = i;
+	}
+	lz4Sequence(out, source + anchor, size - anchor, 0, 0);
+}
+
+// LZ4 frame with independent blocks and no checksums, blocks that do not shrink are stored raw
+static void lz4Frame(const unsigned char* source, size_t size, std::vector<unsigned char>& out, std::vector<int>& hashTable)
+{
+	const unsigned char header[]{ 0x04, 0x22, 0x4D, 0x18, 0x60, 0x70 };
+	out.insert(out.end(), header, header + sizeof(header));
+	out.push_back(static_cast<unsigned char>(xxHash32(header + 4, 2) >> 8));
+	for (size_t begin = 0; begin < size; begin += lz4MaxBlock)
+	{
+		const int blockSize = static_cast<int>(std::min<size_t>(lz4MaxBlock, size - begin));
+		const size_t sizeAt = out.size();
+		out.resize(sizeAt + 4);
+		lz4Block(source + begin, blockSize, out, hashTable);
+		unsigned stored = static_cast<unsigned>(out.size() - sizeAt - 4);
+		if (stored >= static_cast<unsigned>(blockSize))
+		{
+			out.resize(sizeAt + 4);
+			out.insert(out.end(), source + begin, source + begin + blockSize);
+			stored = static_cast<unsigned>(blockSize) | 0x80000000u;
+		}
+		std::memcpy(out.data() + sizeAt, &stored, sizeof(stored));
+	}
+	out.resize(out.size() + 4, 0);
+}
+
+static void schemaTable(FlatBuilder& builder, size_t slot, const std::vector<ArrowColumn>& columns)
+{
+	std::vector<size_t> slots;
+	builder.point(slot, builder.table({ { 0, 2, 0 }, { 1, 0, 0 } }, slots));
+	const size_t fields = builder.offsetVector(static_cast<int>(columns.size()));
+	builder.point(slots[0], fields);
+	for (size_t c = 0; c < columns.size(); c++)
+	{
+		const ColumnType type = columns[c].type;
+		const unsigned long long typeType = type == ColumnType::Float32 ? floatingPointType : intType;
+		slots.clear();
+		builder.point(fields + 4 + 4 * c, builder.table({ { 0, 0, 0 }, { 1, 1, 0 }, { 2, 1, typeType }, { 3, 0, 0 }, { 5, 0, 0 } }, slots));
+		builder.point(slots[0], builder.string(columns[c].name));
+		std::vector<size_t> none;
+		if (type == ColumnType::Float32)
+			builder.point(slots[1], builder.table({ { 0, 2, singlePrecision } }, none));
+		else
+		{
+			const unsigned long long bitWidth = type == ColumnType::UInt8 ? 8 : type == ColumnType::Int32 ? 32 : 64;
+			builder.point(slots[1], builder.table({ { 0, 4, bitWidth }, { 1, 1, type == ColumnType::Int32 } }, none));
+		}
+		builder.point(slots[2], builder.offsetVector(0));
+	}
+}
+
+static size_t messageTable(FlatBuilder& builder, unsigned long long headerType, unsigned long long bodyLength)
+{
+	std::vector<size_t> slots;
+	const size_t root = builder.offsetSlot();
+	builder.point(root, builder.table({ { 0, 2, metadataVersion }, { 1, 1, headerType }, { 2, 0, 0 }, { 3, 8, bodyLength } }, slots));
+	return slots[0];
+}
+
+ArrowWriter::~ArrowWriter()
+{
+	close();
+}
+
+bool ArrowWriter::open(const char* path, const std::vector<ArrowColumn>& columns, int chunkRows)
+{
+	close();
+	m_out.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_out)
+		return false;
+	m_columns = columns;
+	m_values.assign(columns.size(), {});
+	m_batches.clear();
+	m_rows = 0;
+	m_chunkRows = std::max(chunkRows, 1);
+
+	const char magic[8]{ 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+	m_out.write(magic, sizeof(magic));
+	m_offset = sizeof(magic);
+
+	FlatBuilder builder{ m_metadata };
+	schemaTable(builder, messageTable(builder, schemaHeader, 0), m_columns);
+	m_body.clear();
+	writeMessage(m_metadata, m_body, nullptr);
+	return true;
+}
+
+void ArrowWriter::writeMessage(const std::vector<unsigned char>& metadata, const std::vector<unsigned char>& body, Block* block)
+{
+	// Continuation marker and metadata length, metadata padded so the body starts 8 byte aligned
+	const int paddedLength = static_cast<int>((metadata.size() + 7) / 8 * 8);
+	const unsigned continuation = 0xFFFFFFFFu;
+	const char padding[8]{};
+	if (block)
+		*block = Block{ m_offset, 8 + paddedLength, body.size() };
+	m_out.write(reinterpret_cast<const char*>(&continuation), sizeof(continuation));
+	m_out.write(reinterpret_cast<const char*>(&paddedLength), sizeof(paddedLength));
+	m_out.write(reinterpret_cast<const char*>(metadata.data()), metadata.size());
+	m_out.write(padding, paddedLength - metadata.size());
+	m_out.write(reinterpret_cast<const char*>(body.data()), body.size());
+	m_offset += 8 + paddedLength + body.size();
+}
+
+void ArrowWriter::writeBatch()
+{
+	// Each column is an empty validity bitmap, as nothing is null, and its compressed values.
+	// A compressed buffer starts with its uncompressed length, -1 marks one stored as is.
+	struct BufferSpan {
+		long long offset;
+		long long length;
+	};
+	struct FieldNode {
+		long long length;
+		long long nullCount;
+	};
+	std::vector<FieldNode> nodes;
+	std::vector<BufferSpan> buffers;
+	m_body.clear();
+	for (const std::vector<unsigned char>& values : m_values)
+	{
+		nodes.push_back(FieldNode{ m_rows, 0 });
+		buffers.push_back(BufferSpan{ static_cast<long long>(m_body.size()), 0 });
+
+		m_compressed.clear();
+		lz4Frame(values.data(), values.size(), m_compressed, m_hashTable);
+		const bool compressed = m_compressed.size() < values.size();
+		const long long uncompressedLength = compressed ? static_cast<long long>(values.size()) : -1;
+		const size_t begin = m_body.size();
+		m_body.resize(begin + sizeof(uncompressedLength));
+		std::memcpy(m_body.data() + begin, &uncompressedLength, sizeof(uncompressedLength));
+		if (compressed)
+			m_body.insert(m_body.end(), m_compressed.begin(), m_compressed.end());
+		else
+			m_body.insert(m_body.end(), values.begin(), values.end());
+		buffers.push_back(BufferSpan{ static_cast<long long>(begin), static_cast<long long>(m_body.size() - begin) });
+		m_body.resize((m_body.size() + 7) / 8 * 8, 0);
+	}
+
+	FlatBuilder builder{ m_metadata };
+	std::vector<size_t> slots;
+	std::vector<size_t> none;
+	const size_t header = messageTable(builder, recordBatchHeader, m_body.size());
+	builder.point(header, builder.table({ { 0, 8, static_cast<unsigned long long>(m_rows) }, { 1, 0, 0 }, { 2, 0, 0 }, { 3, 0, 0 } }, slots));
+	builder.point(slots[0], builder.structVector(nodes.data(), static_cast<int>(nodes.size()), sizeof(FieldNode)));
+	builder.point(slots[1], builder.structVector(buffers.data(), static_cast<int>(buffers.size()), sizeof(BufferSpan)));
+	builder.point(slots[2], builder.table({ { 0, 1, lz4FrameCodec }, { 1, 1, bufferCompression } }, none));
+
+	Block block;
+	writeMessage(m_metadata, m_body, &block);
+	m_batches.push_back(block);
+	for (std::vector<unsigned char>& values : m_values)
+		values.clear();
+	m_rows = 0;
+}
+
+void ArrowWriter::endRow()
+{
+	if (++m_rows >= m_chunkRows)
+		writeBatch();
+}
+
+void ArrowWriter::close()
+{
+	if (!m_out.is_open())
+		return;
+	if (m_rows > 0)
+		writeBatch();
+
+	// End of stream marker, then the footer repeating the schema and locating every batch
+	const unsigned endOfStream[2]{ 0xFFFFFFFFu, 0 };
+	m_out.write(reinterpret_cast<const char*>(endOfStream), sizeof(endOfStream));
+	m_offset += sizeof(endOfStream);
+
+	struct FooterBlock {
+		long long offset;
+		int metadataLength;
+		int padding;
+		long long bodyLength;
+	};
+	std::vector<FooterBlock> blocks;
+	for (const Block& batch : m_batches)
+		blocks.push_back(FooterBlock{ static_cast<long long>(batch.offset), batch.metadataLength, 0, static_cast<long long>(batch.bodyLength) });
+	FlatBuilder builder{ m_metadata };
+	std::vector<size_t> slots;
+	const size_t root = builder.offsetSlot();
+	builder.point(root, builder.table({ { 0, 2, metadataVersion }, { 1, 0, 0 }, { 3, 0, 0 } }, slots));
+	schemaTable(builder, slots[0], m_columns);
+	builder.point(slots[1], builder.structVector(blocks.data(), static_cast<int>(blocks.size()), sizeof(FooterBlock)));
+
+	const int footerLength = static_cast<int>(m_metadata.size());
+	const char magic[6]{ 'A', 'R', 'R', 'O', 'W', '1' };
+	m_out.write(reinterpret_cast<const char*>(m_metadata.data()), m_metadata.size());
+	m_out.write(reinterpret_cast<const char*>(&footerLength), sizeof(footerLength));
+	m_out.write(magic, sizeof(magic));
+	m_offset += m_metadata.size() + sizeof(footerLength) + sizeof(magic);
+	m_out.close();
+}
+
+bool ArrowWriter::isOpen() const
+{
+	return m_out.is_open();
+}
+
+unsigned long long ArrowWriter::getBytesWritten() const
+{
+	return m_offset;
+}
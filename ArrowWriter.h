@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+
+enum class ColumnType {
+	UInt8,
+	Int32,
+	UInt64,
+	Float32,
+};
+
+struct ArrowColumn {
+	std::string name;
+	ColumnType type{};
+};
+
+// Writes rows into an Arrow IPC file (Feather v2), the format pandas.read_feather and pyarrow read
+// directly. Rows are buffered per column and written as one record batch every chunkRows rows,
+// each column buffer compressed as an LZ4 frame. Values are appended column by column in the
+// declared order and must match the column's type.
+class ArrowWriter
+{
+private:
+	struct Block {
+		unsigned long long offset{};
+		int metadataLength{};
+		unsigned long long bodyLength{};
+	};
+
+	std::ofstream m_out;
+	std::vector<ArrowColumn> m_columns;
+	std::vector<std::vector<unsigned char>> m_values;
+	std::vector<Block> m_batches;
+	std::vector<unsigned char> m_metadata;
+	std::vector<unsigned char> m_body;
+	std::vector<unsigned char> m_compressed;
+	std::vector<int> m_hashTable;
+	unsigned long long m_offset{};
+	int m_rows{};
+	int m_chunkRows{};
+
+	void writeMessage(const std::vector<unsigned char>& metadata, const std::vector<unsigned char>& body, Block* block);
+	void writeBatch();
+
+public:
+	ArrowWriter() = default;
+	ArrowWriter(const ArrowWriter&) = delete;
+	ArrowWriter& operator=(const ArrowWriter&) = delete;
+	~ArrowWriter();
+	bool open(const char* path, const std::vector<ArrowColumn>& columns, int chunkRows);
+	void close();
+	bool isOpen() const;
+	unsigned long long getBytesWritten() const;
+	void endRow();
+
+	template <typename T>
+	void append(int column, T value)
+	{
+		std::vector<unsigned char>& values = m_values[column];
+		values.resize(values.size() + sizeof(T));
+		std::memcpy(values.data() + values.size() - sizeof(T), &value, sizeof(T));
+	}
+};
@@ -0,0 +1,394 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Benchmark.h"
+#include "Fish.h"
+#include "Flock.h"
+#include "SpatialGrid.h"
+#include "IncrementalGrid.h"
+#include "Spawn.h"
+#include "Random.h"
+#include "AllocationCounter.h"
+#include "Octree.h"
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+static const float deltaTime = 1.0f / 120.0f;
+static const unsigned long long benchmarkSeed = 1;
+
+// Viewer defaults for a 50 unit container
+static SimulationConfig benchmarkConfig()
+{
+	return SimulationConfig{ 4.0f, 0.5f, 4.5f, 0.05f, 3.5f, 0.3f, 5.0f, 50.0f, 20.0f };
+}
+
+// Fish spread evenly over the container
+static SpawnConfig benchmarkSpawn(float containerSize, unsigned stream)
+{
+	SpawnConfig spawnConfig;
+	spawnConfig.extent = containerSize * 0.5f;
+	spawnConfig.speed = 35.0f;
+	spawnConfig.seed = benchmarkSeed;
+	spawnConfig.stream = stream;
+	return spawnConfig;
+}
+
+// Compares a full counting-sort rebuild of the grid against incremental maintenance.
+// Fish only steer at the walls so the school keeps its spawn density.
+int runIndexBenchmark(int fishCount, int steps)
+{
+	// Scale the container so density matches a 2000 fish school in the 50 unit viewer cube
+	const float containerSize = 50.0f * std::cbrt(fishCount / 2000.0f);
+	const RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	const SimulationConfig simConfig = benchmarkConfig();
+	const float cellSize = simConfig.alignmentRadius + 1.5f;
+
+	std::vector<Fish> fishes;
+	spawnFishes(fishes, fishCount, benchmarkSpawn(containerSize, 0));
+
+	SpatialGrid rebuiltGrid;
+	IncrementalGrid incrementalGrid;
+	rebuiltGrid.build(fishes, raylibConfig, cellSize);
+	incrementalGrid.build(fishes, raylibConfig, cellSize);
+
+	using Clock = std::chrono::steady_clock;
+	double rebuildMs = 0.0;
+	double incrementalMs = 0.0;
+	long long moved = 0;
+	for (int step = 0; step < steps; step++)
+	{
+		for (Fish& fish : fishes)
+			fish.update(NeighborSums{}, simConfig, raylibConfig, deltaTime);
+
+		Clock::time_point start = Clock::now();
+		rebuiltGrid.build(fishes, raylibConfig, cellSize);
+		Clock::time_point mid = Clock::now();
+		incrementalGrid.build(fishes, raylibConfig, cellSize);
+		Clock::time_point end = Clock::now();
+
+		rebuildMs += std::chrono::duration<double, std::milli>(mid - start).count();
+		incrementalMs += std::chrono::duration<double, std::milli>(end - mid).count();
+		moved += incrementalGrid.getMovedCount();
+	}
+
+	std::cout << "fish: " << fishCount << ", steps: " << steps << std::endl;
+	std::cout << "full rebuild:       " << rebuildMs / steps << " ms/step" << std::endl;
+	std::cout << "incremental update: " << incrementalMs / steps << " ms/step" << std::endl;
+	std::cout << "fish changing cell: " << 100.0 * moved / (static_cast<double>(fishCount) * steps) << " %" << std::endl;
+	return 0;
+}
+
+// Steps independent flocks on one thread each and reports the wall time per step
+int runFlockBenchmark(int flockCount, int fishPerFlock, int steps)
+{
+	const float containerSize = 50.0f;
+	const RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	std::vector<Flock> flocks;
+	flocks.reserve(flockCount);
+	for (int f = 0; f < flockCount; f++)
+	{
+		flocks.emplace_back(benchmarkConfig(), raylibConfig, containerSize * 0.03f);
+		flocks.back().setRandom(Random{ benchmarkSeed, static_cast<unsigned>(f) });
+		flocks.back().setWorkerCount(1);
+		flocks.back().spawn(fishPerFlock, benchmarkSpawn(containerSize, f + 1));
+	}
+
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> workers;
+	for (Flock& flock : flocks)
+	{
+		workers.emplace_back([&flock, steps]() {
+			for (int step = 0; step < steps; step++)
+				flock.step(deltaTime);
+		});
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	Clock::time_point end = Clock::now();
+
+	std::cout << "flocks: " << flockCount << ", fish per flock: " << fishPerFlock << ", steps: " << steps << std::endl;
+	std::cout << "wall time: " << std::chrono::duration<double, std::milli>(end - start).count() / steps << " ms/step" << std::endl;
+	return 0;
+}
+
+// Percentile of frame times in milliseconds, the times are sorted in place
+static double percentile(std::vector<double>& times, double fraction)
+{
+	std::sort(times.begin(), times.end());
+	return times[std::min(static_cast<size_t>(fraction * times.size()), times.size() - 1)];
+}
+
+// Spawns fishPerFrame fish and steps once per frame until the flock holds fishCount fish, once into a
+// flock that grows as it goes and once into one reserved for fishCount up front
+int runSpawnBenchmark(int fishCount, int fishPerFrame)
+{
+	// The full flock has the density of a 2000 fish school in the 50 unit viewer cube
+	const float containerSize = 50.0f * std::cbrt(fishCount / 2000.0f);
+	const RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	fishPerFrame = std::max(fishPerFrame, 1);
+	std::cout << "fish: " << fishCount << ", fish per frame: " << fishPerFrame << std::endl;
+	for (bool reserved : { false, true })
+	{
+		Flock flock{ benchmarkConfig(), raylibConfig, containerSize * 0.03f };
+		flock.setRandom(Random{ benchmarkSeed });
+		if (reserved)
+			flock.reserve(fishCount);
+
+		using Clock = std::chrono::steady_clock;
+		std::vector<double> spawnTimes;
+		std::vector<double> frameTimes;
+		for (unsigned frame = 0; static_cast<int>(flock.getFishes().size()) < fishCount; frame++)
+		{
+			SpawnConfig spawnConfig = benchmarkSpawn(containerSize, frame);
+			const int count = std::min(fishPerFrame, fishCount - static_cast<int>(flock.getFishes().size()));
+			Clock::time_point start = Clock::now();
+			flock.spawn(count, spawnConfig);
+			Clock::time_point mid = Clock::now();
+			flock.step(deltaTime);
+			Clock::time_point end = Clock::now();
+			spawnTimes.push_back(std::chrono::duration<double, std::milli>(mid - start).count());
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		std::cout << (reserved ? "reserved: " : "growing:  ");
+		std::cout << "spawn p50 " << percentile(spawnTimes, 0.5) << " ms, p99 " << percentile(spawnTimes, 0.99) << " ms, max " << spawnTimes.back() << " ms; ";
+		std::cout << "frame p50 " << percentile(frameTimes, 0.5) << " ms, p99 " << percentile(frameTimes, 0.99) << " ms, max " << frameTimes.back() << " ms" << std::endl;
+	}
+	return 0;
+}
+
+// Steps two copies of one flock, the second reading the packed reduced-precision fish in its
+// neighbor loop. Reports how far one step's velocities differ, the time per step of each and how the
+// flocks' order parameters compare once they have drifted apart.
+int runCompactBenchmark(int fishCount, int steps)
+{
+	const float containerSize = 50.0f * std::cbrt(fishCount / 2000.0f);
+	const RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	std::vector<Flock> flocks;
+	flocks.reserve(2);
+	for (int f = 0; f < 2; f++)
+	{
+		flocks.emplace_back(benchmarkConfig(), raylibConfig, containerSize * 0.03f);
+		flocks.back().setRandom(Random{ benchmarkSeed });
+		flocks.back().setWorkerCount(1);
+		flocks.back().setStatsEnabled(true);
+		flocks.back().setCompactStorage(f == 1);
+		flocks.back().spawn(fishCount, benchmarkSpawn(containerSize, 0));
+	}
+
+	// One step from the same state isolates the error of reading packed neighbors
+	for (Flock& flock : flocks)
+		flock.step(deltaTime);
+	double sumError = 0.0;
+	double maxError = 0.0;
+	for (int i = 0; i < fishCount; i++)
+	{
+		const Vector3 velocity = flocks[0].getFishes()[i].getVelocity();
+		const double error = Vector3Distance(velocity, flocks[1].getFishes()[i].getVelocity()) / std::max(Vector3Length(velocity), 1e-6f);
+		sumError += error;
+		maxError = std::max(maxError, error);
+	}
+
+	// Steps alternate between the flocks so both see the same machine load
+	using Clock = std::chrono::steady_clock;
+	double stepMs[2]{};
+	for (int step = 0; step < steps; step++)
+	{
+		for (int f = 0; f < 2; f++)
+		{
+			Clock::time_point start = Clock::now();
+			flocks[f].step(deltaTime);
+			stepMs[f] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+	}
+	for (double& ms : stepMs)
+		ms /= std::max(steps, 1);
+
+	std::cout << "fish: " << fishCount << ", steps: " << steps << std::endl;
+	std::cout << "one step velocity error: mean " << 100.0 * sumError / fishCount << " %, max " << 100.0 * maxError << " % of the speed" << std::endl;
+	std::cout << "full precision: " << stepMs[0] << " ms/step, polarization " << flocks[0].getStats().polarization << ", mean speed " << flocks[0].getStats().meanSpeed << std::endl;
+	std::cout << "compact:        " << stepMs[1] << " ms/step, polarization " << flocks[1].getStats().polarization << ", mean speed " << flocks[1].getStats().meanSpeed << std::endl;
+	return 0;
+}
+
+// One neighbor search setup the allocation check runs through
+struct AllocationMode
+{
+	const char* name;
+	NeighborSearch neighborSearch;
+	bool topological;
+	bool periodic;
+	bool compact;
+};
+
+// Steps a flock with every per-step feature on until its scratch stops growing, then counts heap
+// allocations over the remaining steps.
+static bool checkAllocations(const AllocationMode& mode, int fishCount, int steps)
+{
+	const float containerSize = 50.0f;
+	RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	if (mode.periodic)
+		raylibConfig.boundary = Boundary::Periodic;
+	SimulationConfig simConfig = benchmarkConfig();
+	if (mode.topological)
+		simConfig.topologicalNeighbors = 7;
+	const int warmupSteps = 120;
+	Flock flock{ simConfig, raylibConfig, containerSize * 0.03f };
+	flock.setRandom(Random{ benchmarkSeed });
+	flock.setWorkerCount(std::max(fishCount / 1024, 2));
+	flock.setStatsEnabled(true);
+	flock.setClusteringEnabled(true);
+	flock.setNeighborSearch(mode.neighborSearch);
+	flock.setCompactStorage(mode.compact);
+	SpawnConfig spawnConfig = benchmarkSpawn(containerSize, 0);
+	spawnConfig.distribution = SpawnDistribution::Schools;
+	spawnConfig.schoolCount = 8;
+	spawnConfig.schoolRadius = containerSize * 0.08f;
+	flock.spawn(fishCount, spawnConfig);
+	flock.addPredator(Fish{ Vector3{ 20.0f, 20.0f, 20.0f }, Vector3{ -1.0f, -1.0f, -1.0f } });
+	flock.getMovingObstacles().setConfig(ObstacleConfig{ containerSize * 0.15f, 6.0f });
+	flock.getMovingObstacles().addBox(Vector3{ 0.0f, 0.0f, 0.0f }, Vector3{ 15.0f, 4.0f, 6.0f });
+
+	unsigned long long allocations = 0;
+	int allocatingSteps = 0;
+	for (int step = 0; step < warmupSteps + steps; step++)
+	{
+		flock.getMovingObstacles().setPosition(0, Vector3{ std::sin(step * 0.05f) * containerSize * 0.3f, 0.0f, 0.0f });
+		const unsigned long long before = heapAllocationCount();
+		flock.step(deltaTime);
+		const unsigned long long stepAllocations = heapAllocationCount() - before;
+		if (step >= warmupSteps)
+		{
+			allocations += stepAllocations;
+			allocatingSteps += stepAllocations > 0;
+		}
+	}
+
+	std::cout << mode.name << ": scratch high-water " << flock.getScratchHighWater() / 1024.0 << " KB, ";
+	std::cout << "heap allocations " << allocations << " in " << allocatingSteps << " steps" << std::endl;
+	return allocations == 0;
+}
+
+// Runs the allocation check over every neighbor search mode. Exits with 1 if any step allocated.
+int runAllocationCheck(int fishCount, int steps)
+{
+	const AllocationMode modes[] = {
+		{ "dense grid", NeighborSearch::DenseGrid, false, false, false },
+		{ "topological", NeighborSearch::DenseGrid, true, false, false },
+		{ "octree", NeighborSearch::Octree, false, false, false },
+		{ "hashed grid", NeighborSearch::HashedGrid, false, false, false },
+		{ "periodic", NeighborSearch::DenseGrid, false, true, false },
+		{ "compact", NeighborSearch::DenseGrid, false, false, true },
+	};
+
+	std::cout << "fish: " << fishCount << ", steps: " << steps << " after warmup" << std::endl;
+	bool clean = true;
+	for (const AllocationMode& mode : modes)
+		clean = checkAllocations(mode, fishCount, steps) && clean;
+	return clean ? 0 : 1;
+}
+
+// Checks octree rule sums against a brute-force pass over a seeded school for a few theta values.
+// Only fish within theta * radius of a rule sphere's surface may be counted wrongly, so each sum may
+// differ from the exact one by at most what those fish add to it. Exits with 1 if any sum does not.
+int runOctreeCheck(int fishCount)
+{
+	const float containerSize = 50.0f * std::cbrt(fishCount / 2000.0f);
+	const RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, 5.0f, 5.0f, 5.0f };
+	SimulationConfig simConfig = benchmarkConfig();
+	simConfig.seperationRadius = containerSize * 0.1f;
+	simConfig.alignmentRadius = containerSize * 0.3f;
+	simConfig.cohesionRadius = containerSize * 0.6f;
+	Flock flock{ simConfig, raylibConfig, containerSize * 0.03f };
+	SpawnConfig spawnConfig = benchmarkSpawn(containerSize, 0);
+	spawnConfig.distribution = SpawnDistribution::Schools;
+	spawnConfig.schoolCount = 8;
+	spawnConfig.schoolRadius = containerSize * 0.08f;
+	flock.spawn(fishCount, spawnConfig);
+	const std::vector<Fish>& fishes = flock.getFishes();
+	const float radii[3]{ simConfig.seperationRadius, simConfig.alignmentRadius, simConfig.cohesionRadius };
+
+	std::cout << "fish: " << fishCount << ", radii: " << radii[0] << ", " << radii[1] << ", " << radii[2] << std::endl;
+	int failures = 0;
+	for (float theta : { 0.25f, 0.5f, 1.0f })
+	{
+		Octree octree{ theta, 16 };
+		octree.build(fishes);
+		double worstRatio = 0.0;
+		double sumCenterError = 0.0;
+		double worstCenterError = 0.0;
+		int misclassifiedFish = 0;
+		for (int i = 0; i < fishCount; i++)
+		{
+			const NeighborSums approx = octree.query(i, fishes, simConfig);
+			const Vector3 position = fishes[i].getPosition();
+
+			// Exact sums per rule, what the band fish add to them and a float rounding allowance.
+			// Band fish inside the sphere can only be dropped and those outside only added.
+			Vector3 exact[3]{};
+			float exactWeight[3]{};
+			float band[3]{};
+			float bandInside[3]{};
+			float bandOutside[3]{};
+			float rounding[3]{};
+			for (int j = 0; j < fishCount; j++)
+			{
+				if (j == i) continue;
+				const Vector3 otherPosition = fishes[j].getPosition();
+				const float distance = Vector3Distance(position, otherPosition);
+				const Vector3 terms[3]{ Vector3Subtract(position, otherPosition), fishes[j].getVelocity(), otherPosition };
+				for (int r = 0; r < 3; r++)
+				{
+					const bool inBand = std::fabs(distance - radii[r]) < theta * radii[r];
+					if (distance < radii[r])
+					{
+						exact[r] = Vector3Add(exact[r], terms[r]);
+						exactWeight[r] += 1.0f;
+					}
+					if (inBand)
+					{
+						band[r] += Vector3Length(terms[r]);
+						(distance < radii[r] ? bandInside[r] : bandOutside[r]) += 1.0f;
+					}
+					if (distance < radii[r] || inBand)
+						rounding[r] += 1e-5f * (r == 0 ? Vector3Length(position) + Vector3Length(otherPosition) : Vector3Length(terms[r]));
+				}
+			}
+
+			const Vector3 sums[3]{ approx.closeVel, approx.velocitySum, approx.positionSum };
+			const float weights[3]{ exactWeight[0], approx.alignmentWeight, approx.cohesionWeight };
+			for (int r = 0; r < 3; r++)
+			{
+				const float error = Vector3Distance(sums[r], exact[r]);
+				const float weightError = weights[r] - exactWeight[r];
+				if (error > band[r] + rounding[r] || weightError < -bandInside[r] || weightError > bandOutside[r])
+					failures++;
+				if (band[r] > 0.0f)
+					worstRatio = std::max(worstRatio, static_cast<double>(std::max(error - rounding[r], 0.0f) / band[r]));
+			}
+			misclassifiedFish += weights[1] != exactWeight[1] || weights[2] != exactWeight[2];
+
+			// How far the cohesion target moved, in units of the cohesion radius
+			if (approx.cohesionWeight > 0.0f && exactWeight[2] > 0.0f)
+			{
+				const Vector3 approxCenter = Vector3Scale(approx.positionSum, 1.0f / approx.cohesionWeight);
+				const Vector3 exactCenter = Vector3Scale(exact[2], 1.0f / exactWeight[2]);
+				const double centerError = Vector3Distance(approxCenter, exactCenter) / radii[2];
+				sumCenterError += centerError;
+				worstCenterError = std::max(worstCenterError, centerError);
+			}
+		}
+
+		std::cout << "theta " << theta << ": " << misclassifiedFish << " fish with a neighbor counted wrongly, worst error " << 100.0 * worstRatio << " % of the band bound, ";
+		std::cout << "cohesion centre error mean " << 100.0 * sumCenterError / fishCount << " %, max " << 100.0 * worstCenterError << " % of the radius" << std::endl;
+	}
+	if (failures == 0)
+		std::cout << "every sum is within the bound" << std::endl;
+	else
+		std::cout << failures << " sums outside the bound" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Headless benchmarks started from the command line, no window is opened
+int runIndexBenchmark(int fishCount, int steps);
+int runFlockBenchmark(int flockCount, int fishPerFlock, int steps);
+int runAllocationCheck(int fishCount, int steps);
+int runSpawnBenchmark(int fishCount, int fishPerFrame);
+int runCompactBenchmark(int fishCount, int steps);
+int runOctreeCheck(int fishCount);
@@ -7,13 +7,61 @@
 #include "raylib.h"
 #include "raymath.h"
 #include "Fish.h"
+#include "Flock.h"
+#include "Benchmark.h"
+#include "Random.h"
+#include "Checkpoint.h"
+#include "TrajectoryRecorder.h"
+#include "TrajectoryReplay.h"
+#include "SharedFrames.h"
+#include "FrameReader.h"
+#include "StatsExporter.h"
+#include "Frustum.h"
+#include "AllocationCounter.h"
 #include <vector>
 #include <iostream>
-#include <cstdlib>
 #include <ctime>
+#include <string>
+#include <cmath>
+#include <algorithm>
 
-int main(void)
+int main(int argc, char** argv)
 {
+	// Boids --bench-index [fish] [steps]
+	if (argc > 1 && std::string(argv[1]) == "--bench-index")
+		return runIndexBenchmark(argc > 2 ? std::stoi(argv[2]) : 500000, argc > 3 ? std::stoi(argv[3]) : 100);
+	// Boids --bench-flocks [flocks] [fish per flock] [steps]
+	if (argc > 1 && std::string(argv[1]) == "--bench-flocks")
+		return runFlockBenchmark(argc > 2 ? std::stoi(argv[2]) : 4, argc > 3 ? std::stoi(argv[3]) : 5000, argc > 4 ? std::stoi(argv[4]) : 100);
+	// Boids --bench-spawn [fish] [fish per frame]
+	if (argc > 1 && std::string(argv[1]) == "--bench-spawn")
+		return runSpawnBenchmark(argc > 2 ? std::stoi(argv[2]) : 200000, argc > 3 ? std::stoi(argv[3]) : 1000);
+	// Boids --bench-compact [fish] [steps]
+	if (argc > 1 && std::string(argv[1]) == "--bench-compact")
+		return runCompactBenchmark(argc > 2 ? std::stoi(argv[2]) : 200000, argc > 3 ? std::stoi(argv[3]) : 100);
+	// Boids --check-allocations [fish] [steps], fails if a step allocates once warmed up
+	if (argc > 1 && std::string(argv[1]) == "--check-allocations")
+		return runAllocationCheck(argc > 2 ? std::stoi(argv[2]) : 5000, argc > 3 ? std::stoi(argv[3]) : 300);
+	// Boids --check-octree [fish], fails if an octree rule sum leaves the theta * radius bound
+	if (argc > 1 && std::string(argv[1]) == "--check-octree")
+		return runOctreeCheck(argc > 2 ? std::stoi(argv[2]) : 4000);
+	// Boids --read-frames [frames], reads what a running viewer publishes
+	if (argc > 1 && std::string(argv[1]) == "--read-frames")
+		return runFrameReader(argc > 2 ? std::stoi(argv[2]) : 600);
+
+	// Boids [--seed seed] [--noise factor]: a seed replays the same run, otherwise the clock picks one.
+	// Steering noise stays off unless a factor is given.
+	unsigned long long seed = static_cast<unsigned long long>(std::time(nullptr));
+	float noiseFactor = 0.0f;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		if (std::string(argv[a]) == "--seed")
+			seed = std::stoull(argv[a + 1]);
+		else if (std::string(argv[a]) == "--noise")
+			noiseFactor = std::stof(argv[a + 1]);
+	}
+	const Random random{ seed };
+
 	const int fps = 120;
 	const int screenWidth = 1920;
 	const int screenHeight = 1080;
@@ -41,76 +89,313 @@ int main(void)
 	Shader shader = LoadShader(0, TextFormat("Assets/shaders/glsl%i/grayscale.fs", GLSL_VERSION));
 	sardine.materials[0].shader = shader;                     // Set shader effect to 3d model
 	sardine.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture; // Bind texture to model
+	const BoundingBox sardineBounds = GetModelBoundingBox(sardine);
+
 
+	// Simulation config, pushed to the flock only when a toggle changes it
+	const float marginX = 5.0f;
+	const float marginY = 5.0f;
+	const float marginZ = 5.0f;
+	RaylibConfig raylibConfig{ containerSize, containerSize, containerSize, marginX, marginY, marginZ };
+
+	const float seperationRadius = containerSize * 0.08f;
+	const float seprationFactor = 0.5f;
+	const float alignmentRadius = containerSize * 0.09f;
+	const float alignmentFactor = 0.05f;
+	const float cohesionRadius = containerSize * 0.07f;
+	const float cohesionFactor = 0.3f;
+	const float turnFactor = 5.0f;
+	const float maxSpeed = 50.0f;
+	const float minSpeed = 20.0f;
+	const int topologicalNeighbors = 7;
+	const float neighborSkin = containerSize * 0.03f;
+	SimulationConfig simulationConfig
+	{
+		seperationRadius,
+		seprationFactor,
+		alignmentRadius,
+		alignmentFactor,
+		cohesionRadius,
+		cohesionFactor,
+		turnFactor,
+		maxSpeed,
+		minSpeed
+	};
+	simulationConfig.noiseFactor = noiseFactor;
+
+	// Mackerel school looser and faster, they ignore sardines apart from keeping their distance
+	SimulationConfig mackerelConfig = simulationConfig;
+	mackerelConfig.seperationRadius = containerSize * 0.1f;
+	mackerelConfig.alignmentRadius = containerSize * 0.12f;
+	mackerelConfig.cohesionRadius = containerSize * 0.1f;
+	mackerelConfig.maxSpeed = 60.0f;
+	mackerelConfig.minSpeed = 30.0f;
+	const SpeciesWeights keepDistance{ 1.0f, 0.0f, 0.0f };
 
 	// Create lights
-	std::vector<Fish> fishes;
-	std::srand(static_cast<unsigned>(std::time(nullptr)));
+	Flock flock{ simulationConfig, raylibConfig, neighborSkin };
+	// Every per-fish array is allocated for the largest flock up front so spawning never reallocates
+	const int maxFishCount = 200000;
+	flock.reserve(maxFishCount);
+	const int sardineSpecies = 0;
+	const int mackerelSpecies = flock.addSpecies(mackerelConfig);
+	flock.setSpeciesWeights(sardineSpecies, mackerelSpecies, keepDistance);
+	flock.setRandom(random.stream(0));
+	flock.setSpeciesWeights(mackerelSpecies, sardineSpecies, keepDistance);
+	const Color speciesTint[]{ WHITE, SKYBLUE };
+	const Color schoolTint[]{ WHITE, SKYBLUE, GOLD, PINK, LIME, ORANGE, VIOLET, BEIGE };
+	const int schoolTintCount = sizeof(schoolTint) / sizeof(schoolTint[0]);
+
+	// Predators hunt within a third of the container and scare fish off from a few body lengths
+	const PredatorConfig predatorConfig{ containerSize * 0.3f, 0.05f, containerSize * 0.15f, 3.0f, 45.0f, 25.0f };
+	flock.setPredatorConfig(predatorConfig);
+
+	// Rock and pillar, baked once into the obstacle distance field
+	const Vector3 rockPosition{ containerSize * 0.25f, -containerSize * 0.2f, containerSize * 0.15f };
+	const float rockRadius = containerSize * 0.12f;
+	const Vector3 pillarPosition{ -containerSize * 0.25f, 0.0f, -containerSize * 0.2f };
+	const Vector3 pillarSize{ containerSize * 0.12f, containerSize * 0.6f, containerSize * 0.12f };
+	SignedDistanceField& obstacles = flock.getObstacles();
+	obstacles.setConfig(ObstacleConfig{ containerSize * 0.1f, 4.0f });
+	obstacles.addSphere(rockPosition, rockRadius);
+	obstacles.addBox(pillarPosition, pillarSize);
+	obstacles.bake(raylibConfig, containerSize / 50.0f);
+
+	// Boat and net sweep through the container, fish look ahead for them along their heading
+	const Vector3 boatSize{ containerSize * 0.3f, containerSize * 0.08f, containerSize * 0.12f };
+	const Vector3 netSize{ containerSize * 0.02f, containerSize * 0.3f, containerSize * 0.5f };
+	ObstacleBVH& movingObstacles = flock.getMovingObstacles();
+	movingObstacles.setConfig(ObstacleConfig{ containerSize * 0.15f, 6.0f });
+	const int boat = movingObstacles.addBox(Vector3{ 0.0f, containerSize * 0.4f, 0.0f }, boatSize);
+	const int net = movingObstacles.addBox(Vector3{ 0.0f, containerSize * 0.1f, 0.0f }, netSize);
+	const std::vector<Fish>& fishes = flock.getFishes();
+	Random spawnRandom = random.stream(1);
+	const int bulkSpawnCount = 10000;
+	unsigned spawnStream = 2;
+	const int removeCount = 50;
+	const char* checkpointPath = "sardine.checkpoint";
+	const char* trajectoryPath = "sardine.trajectory";
+	const unsigned keyframeInterval = 120;
+	TrajectoryRecorder recorder;
+	TrajectoryReplay replay;
+	bool replayPaused = false;
+	const int scrubFrames = 4;
+	const std::vector<Fish> noPredators;
+	SharedFramePublisher publisher;
+	const unsigned publishCapacity = maxFishCount;
+	StatsExporter exporter;
+	const int sampleCount = 64;
+	const int sampleInterval = 10;
+	FishHandle focusFish;
+	bool followToggle = false;
 	bool seperationToggle = false;
 	bool alignmentToggle = false;
 	bool cohesionToggle = false;
+	bool schoolToggle = false;
+	bool cullToggle = false;
+	unsigned long long stepAllocations = 0;
+	std::vector<unsigned char> schoolVisible;
 	const Vector3 cubePosition{ 0.0f, 0.0f, 0.0f };
 	while (!WindowShouldClose())
 	{
-		// Set simulation config
-		
-		const float marginX = 5.0f;
-		const float marginY = 5.0f;
-		const float marginZ = 5.0f;
-		Fish::setRaylibConfig(RaylibConfig{ containerSize, containerSize, containerSize, marginX, marginY, marginZ, GetFrameTime() });
-
-		const float seperationRadius = containerSize * 0.08f;
-		const float seprationFactor = 0.5f;
-		const float alignmentRadius = containerSize * 0.09f;
-		const float alignmentFactor = 0.05f;
-		const float cohesionRadius = containerSize * 0.07f;
-		const float cohesionFactor = 0.3f;
-		const float turnFactor = 5.0f;
-		const float maxSpeed = 50.0f;
-		const float minSpeed = 20.0f;
-		Fish::setSimulationConfig(
-			SimulationConfig
-			{
-				seperationRadius,
-				seprationFactor,
-				alignmentRadius,
-				alignmentFactor,
-				cohesionRadius,
-				cohesionFactor,
-				turnFactor,
-				maxSpeed,
-				minSpeed
-			}
-		);
-
 		UpdateCamera(&camera, CAMERA_FREE);
 
 		// Create fish
-		if (IsKeyDown('B'))
+		if (IsKeyDown('B') || IsKeyDown('M'))
 		{
 			const float speedScale = containerSize * 0.2f;
-			float randomFloat1 = -1.0f + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / 2.0f));
-			float randomFloat2 = -1.0f + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / 2.0f));
-			float randomFloat3 = -1.0f + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / 2.0f));
+			float randomFloat1 = spawnRandom.uniform(-1.0f, 1.0f);
+			float randomFloat2 = spawnRandom.uniform(-1.0f, 1.0f);
+			float randomFloat3 = spawnRandom.uniform(-1.0f, 1.0f);
 			Vector3 initVelocity = Vector3Scale(Vector3Normalize(Vector3{ randomFloat1, randomFloat2, randomFloat3 }), speedScale);
-			Fish fish{ Vector3{0.0f, 0.0f, 0.0f}, initVelocity };
-			fishes.push_back(fish);
+			Fish fish{ Vector3{0.0f, 0.0f, 0.0f}, initVelocity, IsKeyDown('M') ? mackerelSpecies : sardineSpecies };
+			flock.addFish(fish);
 		};
 
+		// Create a batch of schools spread over the container
+		if (IsKeyPressed('N'))
+		{
+			SpawnConfig spawnConfig;
+			spawnConfig.distribution = SpawnDistribution::Schools;
+			spawnConfig.extent = containerSize * 0.35f;
+			spawnConfig.speed = containerSize * 0.2f;
+			spawnConfig.schoolCount = 8;
+			spawnConfig.schoolRadius = containerSize * 0.05f;
+			spawnConfig.species = sardineSpecies;
+			spawnConfig.seed = seed;
+			spawnConfig.stream = spawnStream++;
+			flock.spawn(bulkSpawnCount, spawnConfig);
+		}
+
+		// Remove random fish while held
+		if (IsKeyDown('X'))
+		{
+			for (int i = 0; i < removeCount && !fishes.empty(); i++)
+				flock.removeFish(flock.handleOf(static_cast<int>(spawnRandom.uniform() * fishes.size())));
+		}
+
+		// Create predator in a corner of the container
+		if (IsKeyPressed('P'))
+		{
+			const float corner = containerSize * 0.4f;
+			flock.addPredator(Fish{ Vector3{ corner, corner, corner }, Vector3{ -1.0f, -1.0f, -1.0f } });
+		}
+
 		// Utils
 		if (IsKeyPressed('Z')) camera.target = Vector3{ 0.0f, 0.0f, 0.0f };
-		if (IsKeyPressed('K')) fishes.clear();
+		if (IsKeyReleased('C')) followToggle = !followToggle;
+		if (IsKeyPressed('K')) flock.clear();
 		if (IsKeyReleased(KEY_F1)) seperationToggle = !seperationToggle;
 		if (IsKeyReleased(KEY_F2)) alignmentToggle = !alignmentToggle;
 		if (IsKeyReleased(KEY_F3)) cohesionToggle = !cohesionToggle;
+		if (IsKeyReleased(KEY_F4)) schoolToggle = !schoolToggle;
+		if (IsKeyReleased('U')) cullToggle = !cullToggle;
+		flock.setClusteringEnabled(schoolToggle || cullToggle);
+
+		// Record every frame until toggled off, velocities are quantized against each species' max speed
+		if (IsKeyReleased('R'))
+		{
+			if (recorder.isOpen())
+				recorder.close();
+			else
+			{
+				std::vector<float> maxSpeeds;
+				for (int species = 0; species < flock.getSpeciesCount(); species++)
+					maxSpeeds.push_back(flock.getSimulationConfig(species).maxSpeed);
+				recorder.open(trajectoryPath, raylibConfig, maxSpeeds, keyframeInterval);
+			}
+		}
+
+		// Share every step with other processes, see --read-frames
+		if (IsKeyReleased('G'))
+		{
+			if (publisher.isOpen())
+				publisher.close();
+			else
+				publisher.open(SharedFrames::defaultName(), publishCapacity);
+		}
+
+		// Export statistics every step and a few fish every sampleInterval steps
+		if (IsKeyReleased('I'))
+		{
+			if (exporter.isOpen())
+				exporter.close();
+			else
+				exporter.open("sardine.stats.arrow", "sardine.samples.arrow", sampleCount, sampleInterval);
+			flock.setStatsEnabled(exporter.isOpen());
+		}
+
+		// Play the recording back in place of the simulation, the recorder is closed first so its index is written
+		if (IsKeyReleased('V'))
+		{
+			if (replay.isOpen())
+				replay.close();
+			else
+			{
+				recorder.close();
+				replay.open(trajectoryPath);
+				replayPaused = false;
+			}
+		}
+		if (replay.isOpen())
+		{
+			if (IsKeyReleased(KEY_ENTER)) replayPaused = !replayPaused;
+			int replayFrame = replay.getFrame() + (replayPaused ? 0 : 1);
+			if (IsKeyDown(KEY_PERIOD)) replayFrame += scrubFrames;
+			if (IsKeyDown(KEY_COMMA)) replayFrame -= scrubFrames + (replayPaused ? 0 : 1);
+			if (IsKeyPressed(KEY_HOME)) replayFrame = 0;
+			replay.seek(std::max(0, std::min(replayFrame, replay.getFrameCount() - 1)));
+		}
+
+		// Save and restore the whole simulation, the scene's species must match
+		if (IsKeyReleased(KEY_F5))
+			Checkpoint::save(flock, checkpointPath);
+		if (IsKeyReleased(KEY_F9))
+		{
+			Checkpoint checkpoint;
+			if (checkpoint.open(checkpointPath) && static_cast<int>(checkpoint.getHeader().speciesCount) == flock.getSpeciesCount())
+			{
+				checkpoint.restore(flock);
+				raylibConfig = flock.getRaylibConfig();
+				simulationConfig = flock.getSimulationConfig(sardineSpecies);
+				mackerelConfig = flock.getSimulationConfig(mackerelSpecies);
+			}
+		}
+		if (IsKeyReleased('O'))
+			flock.setNeighborSearch(flock.getNeighborSearch() == NeighborSearch::Octree ? NeighborSearch::DenseGrid : NeighborSearch::Octree);
+		if (IsKeyReleased('H'))
+			flock.setNeighborSearch(flock.getNeighborSearch() == NeighborSearch::HashedGrid ? NeighborSearch::DenseGrid : NeighborSearch::HashedGrid);
+		if (IsKeyReleased('J'))
+			flock.setCompactStorage(!flock.getCompactStorage());
+		if (IsKeyReleased('L'))
+		{
+			raylibConfig.boundary = raylibConfig.boundary == Boundary::Periodic ? Boundary::Turn : Boundary::Periodic;
+			flock.setRaylibConfig(raylibConfig);
+		}
+		if (IsKeyReleased('T'))
+		{
+			simulationConfig.topologicalNeighbors = simulationConfig.topologicalNeighbors > 0 ? 0 : topologicalNeighbors;
+			mackerelConfig.topologicalNeighbors = simulationConfig.topologicalNeighbors;
+			flock.setSimulationConfig(simulationConfig, sardineSpecies);
+			flock.setSimulationConfig(mackerelConfig, mackerelSpecies);
+		}
+
+		const float sweep = static_cast<float>(GetTime()) * 0.2f;
+		movingObstacles.setPosition(boat, Vector3{ std::sin(sweep) * containerSize * 0.35f, containerSize * 0.4f, 0.0f });
+		movingObstacles.setPosition(net, Vector3{ std::sin(sweep * 0.7f + 1.0f) * containerSize * 0.35f, containerSize * 0.1f, containerSize * 0.1f });
+		if (!replay.isOpen())
+		{
+			const unsigned long long allocationsBefore = heapAllocationCount();
+			flock.step(GetFrameTime());
+			stepAllocations = heapAllocationCount() - allocationsBefore;
+			recorder.record(fishes);
+			publisher.publish(flock);
+			exporter.record(flock);
+		}
+		const std::vector<Fish>& shownFishes = replay.isOpen() ? replay.getFishes() : fishes;
+		const std::vector<Fish>& shownPredators = replay.isOpen() ? noPredators : flock.getPredators();
+
+		// The radius spheres and the camera stay on one fish, picking another once it is removed
+		if (flock.indexOf(focusFish) < 0 && !fishes.empty())
+			focusFish = flock.handleOf(0);
+		const int focusIndex = replay.isOpen() ? (shownFishes.empty() ? -1 : 0) : flock.indexOf(focusFish);
+		if (followToggle && focusIndex >= 0)
+			camera.target = shownFishes[focusIndex].getPosition();
 
 		// Draw fishes
 		BeginDrawing();
 		ClearBackground(BLACK);
 		BeginMode3D(camera);
 		DrawCubeWires(cubePosition, containerSize, containerSize, containerSize, RAYWHITE);
-		for (Fish& fish : fishes)
+		DrawSphereWires(rockPosition, rockRadius, 12, 12, GRAY);
+		DrawCubeWiresV(pillarPosition, pillarSize, GRAY);
+		DrawCubeWiresV(movingObstacles.getPosition(boat), boatSize, BROWN);
+		DrawCubeWiresV(movingObstacles.getPosition(net), netSize, LIGHTGRAY);
+		// Schools are colored once the flock labeled the fish shown. Schools whose bounds, grown by
+		// a fish's size, lie outside the view are skipped before any fish of theirs is transformed.
+		const float fishScale = containerSize * 0.35f;
+		const std::vector<int>& clusterIds = flock.getClusters().getClusterIds();
+		const std::vector<ClusterBounds>& schoolBounds = flock.getClusters().getBounds();
+		const bool schoolsLabeled = !replay.isOpen() && clusterIds.size() == shownFishes.size() && !schoolBounds.empty();
+		const bool colorSchools = schoolToggle && schoolsLabeled;
+		const bool cullSchools = cullToggle && schoolsLabeled;
+		int drawnSchools = 0;
+		if (cullSchools)
+		{
+			const Frustum frustum = cameraFrustum(camera, static_cast<float>(screenWidth) / screenHeight, 0.01f, 1000.0f);
+			const float fishRadius = Vector3Distance(sardineBounds.min, sardineBounds.max) * 0.5f * fishScale;
+			schoolVisible.resize(schoolBounds.size());
+			for (size_t c = 0; c < schoolBounds.size(); c++)
+			{
+				schoolVisible[c] = sphereVisible(frustum, schoolBounds[c].center, schoolBounds[c].radius + fishRadius);
+				drawnSchools += schoolVisible[c];
+			}
+		}
+		for (size_t i = 0; i < shownFishes.size(); i++)
 		{
+			if (cullSchools && !schoolVisible[clusterIds[i]])
+				continue;
+			const Fish& fish = shownFishes[i];
 			Vector3 normalVel = Vector3Normalize(fish.getVelocity());
 			Quaternion q = QuaternionFromVector3ToVector3(Vector3{ 0, 0, -1.0f }, normalVel);
 			Vector3 rotationAxis;
@@ -118,29 +403,41 @@ int main(void)
 			QuaternionToAxisAngle(q, &rotationAxis, &rotationAngleRad);
 
 			float rotationAngleDeg = rotationAngleRad * 180.0f / PI;
-			const Vector3 modelScale { containerSize * 0.35f, containerSize * 0.35f, containerSize * 0.35f };
-			DrawModelEx(sardine, fish.getPosition(), rotationAxis, rotationAngleDeg, modelScale, WHITE);
-			fish.update(fishes);
+			const Vector3 modelScale { fishScale, fishScale, fishScale };
+			const Color tint = colorSchools ? schoolTint[clusterIds[i] % schoolTintCount] : speciesTint[fish.getSpecies()];
+			DrawModelEx(sardine, fish.getPosition(), rotationAxis, rotationAngleDeg, modelScale, tint);
+		}
+		for (const Fish& predator : shownPredators)
+		{
+			Vector3 normalVel = Vector3Normalize(predator.getVelocity());
+			Quaternion q = QuaternionFromVector3ToVector3(Vector3{ 0, 0, -1.0f }, normalVel);
+			Vector3 rotationAxis;
+			float rotationAngleRad;
+			QuaternionToAxisAngle(q, &rotationAxis, &rotationAngleRad);
+
+			float rotationAngleDeg = rotationAngleRad * 180.0f / PI;
+			const Vector3 modelScale { containerSize * 1.0f, containerSize * 1.0f, containerSize * 1.0f };
+			DrawModelEx(sardine, predator.getPosition(), rotationAxis, rotationAngleDeg, modelScale, RED);
 		}
 
 		// Draw 3D UI
-		if (seperationToggle && !fishes.empty())
+		if (seperationToggle && focusIndex >= 0)
 		{
 			Color red = RED;
 			red.a = 128.0f;
-			DrawSphere(fishes[0].getPosition(), seperationRadius, red);
+			DrawSphere(shownFishes[focusIndex].getPosition(), seperationRadius, red);
 		}
-		if (alignmentToggle && !fishes.empty())
+		if (alignmentToggle && focusIndex >= 0)
 		{
 			Color green = GREEN;
 			green.a = 128.0f;
-			DrawSphere(fishes[0].getPosition(), alignmentRadius, green);
+			DrawSphere(shownFishes[focusIndex].getPosition(), alignmentRadius, green);
 		}
-		if (cohesionToggle && !fishes.empty())
+		if (cohesionToggle && focusIndex >= 0)
 		{
 			Color blue = BLUE;
 			blue.a = 128.0f;
-			DrawSphere(fishes[0].getPosition(), cohesionRadius, blue);
+			DrawSphere(shownFishes[focusIndex].getPosition(), cohesionRadius, blue);
 		}
 		EndMode3D();
 
@@ -148,12 +445,52 @@ int main(void)
 		DrawText(TextFormat("%d", GetFPS()), screenWidth - 30, screenHeight - 30, 20, GREEN);
 		DrawText(TextFormat("x: %.2f y:%.2f z:%.2f", camera.position.x, camera.position.y, camera.position.z), 10, 10, 20, DARKGRAY);
 		DrawText("WASD: move", 10, 40, 20, RAYWHITE);
-		DrawText("B: spawn fish", 10, 60, 20, RAYWHITE);
-		DrawText("K: remove fishes", 10, 80, 20, RAYWHITE);
+		DrawText(TextFormat("B: spawn fish (%d of %d)", static_cast<int>(fishes.size()), flock.getCapacity()), 10, 60, 20, RAYWHITE);
+		DrawText("K: remove fishes and predators", 10, 80, 20, RAYWHITE);
 		DrawText("Z: reset camera", 10, 100, 20, RAYWHITE);
 		DrawText("F1: toggle seperation radius", 10, 120, 20, RAYWHITE);
 		DrawText("F2: toggle alignment radius", 10, 140, 20, RAYWHITE);
 		DrawText("F3: toggle cohesion radius", 10, 160, 20, RAYWHITE);
+		DrawText("F5: save checkpoint, F9: load checkpoint", 10, 360, 20, RAYWHITE);
+		if (recorder.isOpen())
+			DrawText(TextFormat("R: record trajectory (on, %u frames, %.1f MB)", recorder.getFrameCount(), recorder.getBytesWritten() / 1048576.0), 10, 380, 20, RAYWHITE);
+		else
+			DrawText("R: record trajectory (off)", 10, 380, 20, RAYWHITE);
+		if (replay.isOpen())
+			DrawText(TextFormat("V: replay trajectory (frame %d of %d), COMMA/PERIOD: scrub, ENTER: pause, HOME: restart", replay.getFrame() + 1, replay.getFrameCount()), 10, 400, 20, RAYWHITE);
+		else
+			DrawText("V: replay trajectory (off)", 10, 400, 20, RAYWHITE);
+		if (publisher.isOpen())
+			DrawText(TextFormat("G: share frames (on, %llu published)", publisher.getPublishedCount()), 10, 420, 20, RAYWHITE);
+		else
+			DrawText("G: share frames (off)", 10, 420, 20, RAYWHITE);
+		if (exporter.isOpen())
+			DrawText(TextFormat("I: export statistics (on, %d schools, %.1f MB)", flock.getStats().clusterCount, exporter.getBytesWritten() / 1048576.0), 10, 440, 20, RAYWHITE);
+		else
+			DrawText("I: export statistics (off)", 10, 440, 20, RAYWHITE);
+		if (schoolToggle)
+			DrawText(TextFormat("F4: color schools (on, %d schools)", flock.getClusters().getClusterCount()), 10, 460, 20, RAYWHITE);
+		else
+			DrawText("F4: color schools (off)", 10, 460, 20, RAYWHITE);
+		if (cullSchools)
+			DrawText(TextFormat("U: cull schools outside the view (on, %d of %d drawn)", drawnSchools, static_cast<int>(schoolBounds.size())), 10, 480, 20, RAYWHITE);
+		else
+			DrawText(TextFormat("U: cull schools outside the view (%s)", cullToggle ? "on" : "off"), 10, 480, 20, RAYWHITE);
+		DrawText(TextFormat("Step scratch: %.1f KB high-water, %llu heap allocations", flock.getScratchHighWater() / 1024.0, stepAllocations), 10, 500, 20, RAYWHITE);
+		DrawText(TextFormat("J: 16-bit fish in the neighbor loop (%s)", flock.getCompactStorage() ? "on" : "off"), 10, 520, 20, RAYWHITE);
+		const NeighborSearch neighborSearch = flock.getNeighborSearch();
+		DrawText(TextFormat("O: toggle octree far-field (%s)", neighborSearch == NeighborSearch::Octree ? "on" : "off"), 10, 180, 20, RAYWHITE);
+		DrawText(TextFormat("T: toggle topological neighbors (%s)", simulationConfig.topologicalNeighbors > 0 ? "on" : "off"), 10, 200, 20, RAYWHITE);
+		if (neighborSearch == NeighborSearch::HashedGrid)
+			DrawText(TextFormat("H: toggle hashed grid (on, %d cells)", flock.getHashedCellCount()), 10, 220, 20, RAYWHITE);
+		else
+			DrawText("H: toggle hashed grid (off)", 10, 220, 20, RAYWHITE);
+		DrawText("M: spawn mackerel", 10, 240, 20, RAYWHITE);
+		DrawText("P: spawn predator", 10, 260, 20, RAYWHITE);
+		DrawText(TextFormat("L: toggle wraparound walls (%s)", raylibConfig.boundary == Boundary::Periodic ? "on" : "off"), 10, 280, 20, RAYWHITE);
+		DrawText(TextFormat("N: spawn %d fish in schools", bulkSpawnCount), 10, 300, 20, RAYWHITE);
+		DrawText("X: remove fish", 10, 320, 20, RAYWHITE);
+		DrawText(TextFormat("C: follow fish (%s)", followToggle ? "on" : "off"), 10, 340, 20, RAYWHITE);
 		EndDrawing();
 	}
 	UnloadModel(sardine);
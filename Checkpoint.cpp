@@ -0,0 +1,278 @@
+#include "raylib.h"
+#include "Checkpoint.h"
+#include "Flock.h"
+#include "SpatialGrid.h"
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+
+static const char checkpointMagic[8]{ 'S', 'A', 'R', 'D', 'C', 'K', 'P', 'T' };
+static const unsigned checkpointVersion = 1;
+static const unsigned long long sectionAlignment = 64;
+// Bounds the species matrix so its size cannot overflow, the same cap trajectories use
+static const int maxCheckpointSpecies = 256;
+
+static_assert(std::is_trivially_copyable<CheckpointHeader>::value, "checkpoint header is written as raw bytes");
+static_assert(std::is_trivially_copyable<SimulationConfig>::value, "species configs are written as raw bytes");
+
+static unsigned long long alignSection(unsigned long long offset)
+{
+	return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+}
+
+// Reserves the next aligned section of the given size and returns its offset
+static unsigned long long placeSection(unsigned long long& end, unsigned long long bytes)
+{
+	const unsigned long long offset = alignSection(end);
+	end = offset + bytes;
+	return offset;
+}
+
+static void writeSection(std::ofstream& out, unsigned long long offset, const void* data, unsigned long long bytes)
+{
+	// Pad up to the section, then the raw array
+	static const char zeros[sectionAlignment]{};
+	const unsigned long long position = static_cast<unsigned long long>(out.tellp());
+	out.write(zeros, static_cast<std::streamsize>(offset - position));
+	out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+}
+
+bool Checkpoint::save(const Flock& flock, const char* path)
+{
+	const std::vector<Fish>& fishes = flock.getFishes();
+	const std::vector<Fish>& predators = flock.getPredators();
+	const int speciesCount = flock.getSpeciesCount();
+	if (speciesCount > maxCheckpointSpecies)
+		return false;
+
+	std::vector<SimulationConfig> configs;
+	std::vector<SpeciesWeights> weights;
+	for (int a = 0; a < speciesCount; a++)
+	{
+		configs.push_back(flock.getSimulationConfig(a));
+		for (int b = 0; b < speciesCount; b++)
+			weights.push_back(flock.getSpeciesWeights(a, b));
+	}
+	std::vector<Vector3> positions(fishes.size());
+	std::vector<Vector3> velocities(fishes.size());
+	std::vector<int> species(fishes.size());
+	for (size_t i = 0; i < fishes.size(); i++)
+	{
+		positions[i] = fishes[i].getPosition();
+		velocities[i] = fishes[i].getVelocity();
+		species[i] = fishes[i].getSpecies();
+	}
+	std::vector<Vector3> predatorPositions(predators.size());
+	std::vector<Vector3> predatorVelocities(predators.size());
+	for (size_t i = 0; i < predators.size(); i++)
+	{
+		predatorPositions[i] = predators[i].getPosition();
+		predatorVelocities[i] = predators[i].getVelocity();
+	}
+
+	CheckpointHeader header;
+	std::memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+	header.version = checkpointVersion;
+	header.fishCount = static_cast<unsigned>(fishes.size());
+	header.speciesCount = static_cast<unsigned>(speciesCount);
+	header.predatorCount = static_cast<unsigned>(predators.size());
+	header.stepCount = flock.getStepCount();
+	header.seed = flock.getRandom().getSeed();
+	header.counter = flock.getRandom().getCounter();
+	header.stream = flock.getRandom().getStream();
+	header.neighborSkin = flock.getNeighborSkin();
+	header.raylibConfig = flock.getRaylibConfig();
+	header.predatorConfig = flock.getPredatorConfig();
+
+	unsigned long long end = sizeof(CheckpointHeader);
+	header.speciesConfigs = placeSection(end, configs.size() * sizeof(SimulationConfig));
+	header.speciesWeights = placeSection(end, weights.size() * sizeof(SpeciesWeights));
+	header.positions = placeSection(end, positions.size() * sizeof(Vector3));
+	header.velocities = placeSection(end, velocities.size() * sizeof(Vector3));
+	header.species = placeSection(end, species.size() * sizeof(int));
+	header.predatorPositions = placeSection(end, predatorPositions.size() * sizeof(Vector3));
+	header.predatorVelocities = placeSection(end, predatorVelocities.size() * sizeof(Vector3));
+	header.fileSize = end;
+
+	std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+	if (!out)
+		return false;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writeSection(out, header.speciesConfigs, configs.data(), configs.size() * sizeof(SimulationConfig));
+	writeSection(out, header.speciesWeights, weights.data(), weights.size() * sizeof(SpeciesWeights));
+	writeSection(out, header.positions, positions.data(), positions.size() * sizeof(Vector3));
+	writeSection(out, header.velocities, velocities.data(), velocities.size() * sizeof(Vector3));
+	writeSection(out, header.species, species.data(), species.size() * sizeof(int));
+	writeSection(out, header.predatorPositions, predatorPositions.data(), predatorPositions.size() * sizeof(Vector3));
+	writeSection(out, header.predatorVelocities, predatorVelocities.data(), predatorVelocities.size() * sizeof(Vector3));
+	return static_cast<bool>(out);
+}
+
+// Values a file could hold but the simulation cannot run with: non-finite floats,
+// negative sizes, speed ranges upside down or an unknown boundary
+static bool finite(Vector3 v)
+{
+	return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+static bool validRaylibConfig(const RaylibConfig& config)
+{
+	const bool container = std::isfinite(config.containerWidth) && std::isfinite(config.containerHeight) && std::isfinite(config.containerDepth)
+		&& config.containerWidth > 0.0f && config.containerHeight > 0.0f && config.containerDepth > 0.0f;
+	const bool margins = std::isfinite(config.MarginX) && std::isfinite(config.MarginY) && std::isfinite(config.MarginZ)
+		&& config.MarginX >= 0.0f && config.MarginY >= 0.0f && config.MarginZ >= 0.0f;
+	return container && margins && (config.boundary == Boundary::Turn || config.boundary == Boundary::Periodic);
+}
+
+static bool validSimulationConfig(const SimulationConfig& config)
+{
+	const float radii[3]{ config.seperationRadius, config.alignmentRadius, config.cohesionRadius };
+	for (float radius : radii)
+	{
+		if (!std::isfinite(radius) || radius < 0.0f)
+			return false;
+	}
+	return std::isfinite(config.seperationFactor) && std::isfinite(config.alignmentFactor) && std::isfinite(config.cohesionFactor)
+		&& std::isfinite(config.turnFactor) && std::isfinite(config.noiseFactor) && config.noiseFactor >= 0.0f
+		&& std::isfinite(config.maxSpeed) && std::isfinite(config.minSpeed) && config.minSpeed >= 0.0f && config.minSpeed <= config.maxSpeed
+		&& config.topologicalNeighbors >= 0 && config.topologicalNeighbors <= maxNearestNeighbors;
+}
+
+static bool validPredatorConfig(const PredatorConfig& config)
+{
+	return std::isfinite(config.huntRadius) && std::isfinite(config.chaseFactor) && std::isfinite(config.fleeRadius) && std::isfinite(config.fleeFactor)
+		&& config.huntRadius >= 0.0f && config.fleeRadius >= 0.0f
+		&& std::isfinite(config.maxSpeed) && std::isfinite(config.minSpeed) && config.minSpeed >= 0.0f && config.minSpeed <= config.maxSpeed;
+}
+
+bool Checkpoint::validSection(unsigned long long offset, unsigned long long bytes) const
+{
+	return offset % sectionAlignment == 0 && offset <= m_file.size() && bytes <= m_file.size() - offset;
+}
+
+bool Checkpoint::open(const char* path)
+{
+	// The arrays are used straight from the mapping once the header, the configs and every fish check out
+	m_header = nullptr;
+	if (!m_file.open(path) || m_file.size() < sizeof(CheckpointHeader))
+		return false;
+	const CheckpointHeader* header = reinterpret_cast<const CheckpointHeader*>(m_file.data());
+	if (std::memcmp(header->magic, checkpointMagic, sizeof(checkpointMagic)) != 0 || header->version != checkpointVersion || header->fileSize != m_file.size())
+		return false;
+	const unsigned long long fishCount = header->fishCount;
+	const unsigned long long speciesCount = header->speciesCount;
+	const unsigned long long predatorCount = header->predatorCount;
+	if (speciesCount == 0 || speciesCount > maxCheckpointSpecies
+		|| !validSection(header->speciesConfigs, speciesCount * sizeof(SimulationConfig))
+		|| !validSection(header->speciesWeights, speciesCount * speciesCount * sizeof(SpeciesWeights))
+		|| !validSection(header->positions, fishCount * sizeof(Vector3))
+		|| !validSection(header->velocities, fishCount * sizeof(Vector3))
+		|| !validSection(header->species, fishCount * sizeof(int))
+		|| !validSection(header->predatorPositions, predatorCount * sizeof(Vector3))
+		|| !validSection(header->predatorVelocities, predatorCount * sizeof(Vector3)))
+		return false;
+	if (!validRaylibConfig(header->raylibConfig) || !validPredatorConfig(header->predatorConfig) || !std::isfinite(header->neighborSkin) || header->neighborSkin < 0.0f)
+		return false;
+
+	const unsigned char* data = m_file.data();
+	const SimulationConfig* configs = reinterpret_cast<const SimulationConfig*>(data + header->speciesConfigs);
+	const SpeciesWeights* weights = reinterpret_cast<const SpeciesWeights*>(data + header->speciesWeights);
+	for (unsigned long long a = 0; a < speciesCount; a++)
+	{
+		if (!validSimulationConfig(configs[a]))
+			return false;
+	}
+	for (unsigned long long w = 0; w < speciesCount * speciesCount; w++)
+	{
+		if (!std::isfinite(weights[w].seperation) || !std::isfinite(weights[w].alignment) || !std::isfinite(weights[w].cohesion))
+			return false;
+	}
+
+	// A species index past the stored configs would read outside the species tables
+	const Vector3* positions = reinterpret_cast<const Vector3*>(data + header->positions);
+	const Vector3* velocities = reinterpret_cast<const Vector3*>(data + header->velocities);
+	const int* species = reinterpret_cast<const int*>(data + header->species);
+	for (unsigned long long i = 0; i < fishCount; i++)
+	{
+		if (species[i] < 0 || static_cast<unsigned long long>(species[i]) >= speciesCount || !finite(positions[i]) || !finite(velocities[i]))
+			return false;
+	}
+	const Vector3* predatorPositions = reinterpret_cast<const Vector3*>(data + header->predatorPositions);
+	const Vector3* predatorVelocities = reinterpret_cast<const Vector3*>(data + header->predatorVelocities);
+	for (unsigned long long i = 0; i < predatorCount; i++)
+	{
+		if (!finite(predatorPositions[i]) || !finite(predatorVelocities[i]))
+			return false;
+	}
+	m_header = header;
+	return true;
+}
+
+const CheckpointHeader& Checkpoint::getHeader() const
+{
+	return *m_header;
+}
+
+const SimulationConfig* Checkpoint::speciesConfigs() const
+{
+	return reinterpret_cast<const SimulationConfig*>(m_file.data() + m_header->speciesConfigs);
+}
+
+const SpeciesWeights* Checkpoint::speciesWeights() const
+{
+	return reinterpret_cast<const SpeciesWeights*>(m_file.data() + m_header->speciesWeights);
+}
+
+const Vector3* Checkpoint::positions() const
+{
+	return reinterpret_cast<const Vector3*>(m_file.data() + m_header->positions);
+}
+
+const Vector3* Checkpoint::velocities() const
+{
+	return reinterpret_cast<const Vector3*>(m_file.data() + m_header->velocities);
+}
+
+const int* Checkpoint::species() const
+{
+	return reinterpret_cast<const int*>(m_file.data() + m_header->species);
+}
+
+const Vector3* Checkpoint::predatorPositions() const
+{
+	return reinterpret_cast<const Vector3*>(m_file.data() + m_header->predatorPositions);
+}
+
+const Vector3* Checkpoint::predatorVelocities() const
+{
+	return reinterpret_cast<const Vector3*>(m_file.data() + m_header->predatorVelocities);
+}
+
+void Checkpoint::restore(Flock& flock) const
+{
+	const CheckpointHeader& header = *m_header;
+	const int speciesCount = static_cast<int>(header.speciesCount);
+	flock.clear();
+	flock.setRaylibConfig(header.raylibConfig);
+	flock.setNeighborSkin(header.neighborSkin);
+	flock.setSpecies(std::vector<SimulationConfig>(speciesConfigs(), speciesConfigs() + speciesCount),
+		std::vector<SpeciesWeights>(speciesWeights(), speciesWeights() + speciesCount * speciesCount));
+	flock.setPredatorConfig(header.predatorConfig);
+
+	Random random{ header.seed, header.stream };
+	random.setCounter(header.counter);
+	flock.setRandom(random);
+	flock.setStepCount(header.stepCount);
+
+	const Vector3* fishPositions = positions();
+	const Vector3* fishVelocities = velocities();
+	const int* fishSpecies = species();
+	if (flock.getCapacity() > 0)
+		flock.reserve(static_cast<int>(header.fishCount));
+	for (unsigned i = 0; i < header.fishCount; i++)
+		flock.addFish(Fish{ fishPositions[i], fishVelocities[i], fishSpecies[i] });
+	for (unsigned i = 0; i < header.predatorCount; i++)
+		flock.addPredator(Fish{ predatorPositions()[i], predatorVelocities()[i] });
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "Predators.h"
+#include "MappedFile.h"
+
+class Flock;
+
+// Fixed header at the start of a checkpoint file. Sections are raw arrays at the listed byte offsets,
+// aligned to a cache line, so a mapped file is used in place. Bump checkpointVersion whenever the
+// layout or any stored struct changes.
+struct CheckpointHeader {
+	char magic[8]{};
+	unsigned version{};
+	unsigned fishCount{};
+	unsigned speciesCount{};
+	unsigned predatorCount{};
+	unsigned long long fileSize{};
+	unsigned long long stepCount{};
+	unsigned long long seed{};
+	unsigned long long counter{};
+	unsigned stream{};
+	float neighborSkin{};
+	RaylibConfig raylibConfig{};
+	PredatorConfig predatorConfig{};
+	unsigned long long speciesConfigs{};
+	unsigned long long speciesWeights{};
+	unsigned long long positions{};
+	unsigned long long velocities{};
+	unsigned long long species{};
+	unsigned long long predatorPositions{};
+	unsigned long long predatorVelocities{};
+};
+
+// Binary snapshot of a flock: fish, predators, species configs and matrix, random stream and step.
+// Flocks of up to 256 species can be saved.
+// Obstacles are scene setup and stay as the application configured them. The order neighbors are
+// summed in comes from the spatial index history and is not stored, so a restored run matches the
+// original up to float rounding rather than bit for bit.
+class Checkpoint
+{
+private:
+	MappedFile m_file;
+	const CheckpointHeader* m_header{};
+
+	bool validSection(unsigned long long offset, unsigned long long bytes) const;
+
+public:
+	static bool save(const Flock& flock, const char* path);
+	bool open(const char* path);
+	const CheckpointHeader& getHeader() const;
+	const SimulationConfig* speciesConfigs() const;
+	const SpeciesWeights* speciesWeights() const;
+	const Vector3* positions() const;
+	const Vector3* velocities() const;
+	const int* species() const;
+	const Vector3* predatorPositions() const;
+	const Vector3* predatorVelocities() const;
+	void restore(Flock& flock) const;
+};
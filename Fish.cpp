@@ -1,13 +1,13 @@
 #include "raylib.h"
 #include "raymath.h"
 #include "Fish.h"
+#include "PackedFishes.h"
+#include "SchoolClusters.h"
 #include <vector>
 #include <iostream>
+#include <cmath>
 
-SimulationConfig Fish::m_simulationConfig;
-RaylibConfig Fish::m_raylibConfig;
-
-Fish::Fish(Vector3 pos, Vector3 vel) : m_position{ pos }, m_velocity{ vel } {};
+Fish::Fish(Vector3 pos, Vector3 vel, int species) : m_position{ pos }, m_velocity{ vel }, m_species{ species } {};
 
 Vector3 Fish::getPosition() const
 {
@@ -24,97 +24,199 @@ Color Fish::getColor() const
 	return m_color;
 };
 
-void Fish::update(const std::vector<Fish>& fishes)
+int Fish::getSpecies() const
+{
+	return m_species;
+};
+
+// One neighbor's share of the three rules. The radius tests become 0/1 factors so every pair runs
+// the same straight-line code whatever the species. Only the linking variant tracks the nearest
+// distance and writes links, for step statistics and schools.
+template <bool linking>
+static inline void accumulate(NeighborSums& sums, Vector3 position, Vector3 otherPosition, Vector3 otherVelocity, const SpeciesWeights& weights,
+	float seperationRadius, float alignmentRadius, float cohesionRadius, int other, int* links)
+{
+	float dist = Vector3Distance(position, otherPosition);
+
+	float seperation = (dist < seperationRadius) * weights.seperation;
+	float alignment = (dist < alignmentRadius) * weights.alignment;
+	float cohesion = (dist < cohesionRadius) * weights.cohesion;
+
+	sums.closeVel.x += (position.x - otherPosition.x) * seperation;
+	sums.closeVel.y += (position.y - otherPosition.y) * seperation;
+	sums.closeVel.z += (position.z - otherPosition.z) * seperation;
+
+	sums.velocitySum.x += otherVelocity.x * alignment;
+	sums.velocitySum.y += otherVelocity.y * alignment;
+	sums.velocitySum.z += otherVelocity.z * alignment;
+	sums.alignmentWeight += alignment;
+
+	sums.positionSum.x += otherPosition.x * cohesion;
+	sums.positionSum.y += otherPosition.y * cohesion;
+	sums.positionSum.z += otherPosition.z * cohesion;
+	sums.cohesionWeight += cohesion;
+
+	if (linking)
+	{
+		sums.nearestDistance = std::fmin(sums.nearestDistance, dist);
+		links[sums.linkCount] = other;
+		sums.linkCount += dist < alignmentRadius;
+	}
+}
+
+// Neighbor loops over the full precision fish and over the packed copy. Only the periodic loop reads
+// images, the other one sees every neighbor where it is without adding a shift.
+template <bool periodic, bool linking>
+static NeighborSums gatherFishes(const Fish& self, const std::vector<Fish>& fishes, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts,
+	const SpeciesWeights* speciesWeights, float seperationRadius, float alignmentRadius, float cohesionRadius, int* links)
+{
+	NeighborSums sums;
+	const Vector3 position = self.getPosition();
+	for (int n = 0; n < neighborCount; n++)
+	{
+		const Fish& other = fishes[neighbors[n]];
+		if (&other == &self) continue;
+		Vector3 otherPosition = periodic ? Vector3Add(other.getPosition(), imageShifts[images[n]]) : other.getPosition();
+		accumulate<linking>(sums, position, otherPosition, other.getVelocity(), speciesWeights[other.getSpecies()], seperationRadius, alignmentRadius, cohesionRadius, neighbors[n], links);
+	}
+	return sums;
+}
+
+template <bool periodic, bool linking>
+static NeighborSums gatherPacked(Vector3 position, const PackedFishes& fishes, int self, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts,
+	const SpeciesWeights* speciesWeights, float seperationRadius, float alignmentRadius, float cohesionRadius, int* links)
+{
+	NeighborSums sums;
+	for (int n = 0; n < neighborCount; n++)
+	{
+		const int other = neighbors[n];
+		if (other == self) continue;
+		Vector3 otherPosition = periodic ? Vector3Add(fishes.position(other), imageShifts[images[n]]) : fishes.position(other);
+		accumulate<linking>(sums, position, otherPosition, fishes.velocity(other), speciesWeights[fishes.species(other)], seperationRadius, alignmentRadius, cohesionRadius, other, links);
+	}
+	return sums;
+}
+
+NeighborSums Fish::gather(const std::vector<Fish>& fishes, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts, const SimulationConfig& simConfig, const SpeciesWeights* speciesWeights, int* links) const
+{
+	// In topological mode the neighbors are already the k nearest, alignment and cohesion use all of them
+	const bool topological = simConfig.topologicalNeighbors > 0;
+	const float alignmentRadius = topological ? INFINITY : simConfig.alignmentRadius;
+	const float cohesionRadius = topological ? INFINITY : simConfig.cohesionRadius;
+
+	// speciesWeights is this fish's row of the species matrix.
+	// With images, each neighbor is seen through the periodic image its shift was picked for when the list was built.
+	// Without them, in a closed container or the topological search, it is seen where it is.
+	// Every neighbor within alignment radius is written to links, which has room for neighborCount.
+	// Without links the nearest distance and link count are left as they are.
+	const float seperationRadius = simConfig.seperationRadius;
+	if (images)
+	{
+		return links
+			? gatherFishes<true, true>(*this, fishes, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links)
+			: gatherFishes<true, false>(*this, fishes, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links);
+	}
+	return links
+		? gatherFishes<false, true>(*this, fishes, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links)
+		: gatherFishes<false, false>(*this, fishes, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links);
+};
+
+NeighborSums Fish::gather(const PackedFishes& fishes, int self, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts, const SimulationConfig& simConfig, const SpeciesWeights* speciesWeights, int* links) const
 {
-	Vector3 closeVel{ 0.0, 0.0 };
-	Vector3 neighborAvgVel{ 0.0, 0.0 };
-	Vector3 neighborAvgPos{ 0.0, 0.0 };
-	int alignmentNeighbors = 0;
-	int cohesionNeighbors = 0;
+	// Same rules reading neighbors from the packed copy, this fish itself keeps its full precision position
+	const bool topological = simConfig.topologicalNeighbors > 0;
+	const float alignmentRadius = topological ? INFINITY : simConfig.alignmentRadius;
+	const float cohesionRadius = topological ? INFINITY : simConfig.cohesionRadius;
 
-	for (const Fish& other : fishes)
+	const float seperationRadius = simConfig.seperationRadius;
+	if (images)
 	{
-		if (&other == this) continue;
-		Vector3 otherPosition = other.getPosition();
-		Vector3 otherVelocity = other.getVelocity();
-		float dist = Vector3Distance(m_position, otherPosition);
-
-		if (dist < m_simulationConfig.seperationRadius)
-		{
-			closeVel.x += m_position.x - otherPosition.x;
-			closeVel.y += m_position.y - otherPosition.y;
-			closeVel.z += m_position.z - otherPosition.z;
-		}
-		if (dist < m_simulationConfig.alignmentRadius)
-		{
-			neighborAvgVel.x += otherVelocity.x;
-			neighborAvgVel.y += otherVelocity.y;
-			neighborAvgVel.z += otherVelocity.z;
-			alignmentNeighbors += 1;
-		}
-		if (dist < m_simulationConfig.cohesionRadius)
-		{
-			neighborAvgPos.x += otherPosition.x;
-			neighborAvgPos.y += otherPosition.y;
-			neighborAvgPos.z += otherPosition.z;
-			cohesionNeighbors += 1;
-		}
+		return links
+			? gatherPacked<true, true>(m_position, fishes, self, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links)
+			: gatherPacked<true, false>(m_position, fishes, self, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links);
 	}
+	return links
+		? gatherPacked<false, true>(m_position, fishes, self, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links)
+		: gatherPacked<false, false>(m_position, fishes, self, neighbors, images, neighborCount, imageShifts, speciesWeights, seperationRadius, alignmentRadius, cohesionRadius, links);
+};
+
+Vector3 Fish::steer(const NeighborSums& sums, const SimulationConfig& simConfig) const
+{
+	Vector3 closeVel = sums.closeVel;
+	Vector3 neighborAvgVel = sums.velocitySum;
+	Vector3 neighborAvgPos = sums.positionSum;
+	float alignmentWeight = sums.alignmentWeight;
+	float cohesionWeight = sums.cohesionWeight;
+	Vector3 velocity = m_velocity;
 
 	// Seperation
-	m_velocity.x += closeVel.x * m_simulationConfig.seperationFactor;
-	m_velocity.y += closeVel.y * m_simulationConfig.seperationFactor;
-	m_velocity.z += closeVel.z * m_simulationConfig.seperationFactor;
+	velocity.x += closeVel.x * simConfig.seperationFactor;
+	velocity.y += closeVel.y * simConfig.seperationFactor;
+	velocity.z += closeVel.z * simConfig.seperationFactor;
 
 	// Alignment
-	if (alignmentNeighbors > 0)
+	if (alignmentWeight > 0)
 	{
-		neighborAvgVel.x /= alignmentNeighbors;
-		neighborAvgVel.y /= alignmentNeighbors;
-		neighborAvgVel.z /= alignmentNeighbors;
-		m_velocity.x += (neighborAvgVel.x - m_velocity.x) * m_simulationConfig.alignmentFactor;
-		m_velocity.y += (neighborAvgVel.y - m_velocity.y) * m_simulationConfig.alignmentFactor;
-		m_velocity.z += (neighborAvgVel.z - m_velocity.z) * m_simulationConfig.alignmentFactor;
+		neighborAvgVel.x /= alignmentWeight;
+		neighborAvgVel.y /= alignmentWeight;
+		neighborAvgVel.z /= alignmentWeight;
+		velocity.x += (neighborAvgVel.x - velocity.x) * simConfig.alignmentFactor;
+		velocity.y += (neighborAvgVel.y - velocity.y) * simConfig.alignmentFactor;
+		velocity.z += (neighborAvgVel.z - velocity.z) * simConfig.alignmentFactor;
 	}
 	
 	// Cohesion
-	if (cohesionNeighbors > 0)
+	if (cohesionWeight > 0)
 	{
-		neighborAvgPos.x /= cohesionNeighbors;
-		neighborAvgPos.y /= cohesionNeighbors;
-		neighborAvgPos.z /= cohesionNeighbors;
-		m_velocity.x += (neighborAvgPos.x - m_position.x) * m_simulationConfig.cohesionFactor;
-		m_velocity.y += (neighborAvgPos.y - m_position.y) * m_simulationConfig.cohesionFactor;
-		m_velocity.z += (neighborAvgPos.z - m_position.z) * m_simulationConfig.cohesionFactor;
+		neighborAvgPos.x /= cohesionWeight;
+		neighborAvgPos.y /= cohesionWeight;
+		neighborAvgPos.z /= cohesionWeight;
+		velocity.x += (neighborAvgPos.x - m_position.x) * simConfig.cohesionFactor;
+		velocity.y += (neighborAvgPos.y - m_position.y) * simConfig.cohesionFactor;
+		velocity.z += (neighborAvgPos.z - m_position.z) * simConfig.cohesionFactor;
 	}
 
-	// Edge turning
-	int marginX = m_raylibConfig.MarginX;
-	int marginY = m_raylibConfig.MarginY;
-	int marginZ = m_raylibConfig.MarginZ;
-	float tf = m_simulationConfig.turnFactor;
-	if (m_position.x > m_raylibConfig.containerWidth / 2 - marginX)
-		m_velocity.x -= tf;
-	
-	if (m_position.x < -m_raylibConfig.containerWidth / 2 + marginX)
-		m_velocity.x += tf;
-	
-	if (m_position.y > m_raylibConfig.containerHeight / 2 - marginY)
-		m_velocity.y -= tf;
-	
-	if (m_position.y < -m_raylibConfig.containerHeight / 2 + marginY)
-		m_velocity.y += tf;
-	
-	if (m_position.z > m_raylibConfig.containerDepth / 2 - marginZ)
-		m_velocity.z -= tf;
-	
-	if (m_position.z < -m_raylibConfig.containerDepth / 2 + marginZ)
-		m_velocity.z += tf;
+	// Predators and obstacles
+	velocity.x += sums.steering.x;
+	velocity.y += sums.steering.y;
+	velocity.z += sums.steering.z;
+	return velocity;
+};
+
+void Fish::update(const NeighborSums& sums, const SimulationConfig& simConfig, const RaylibConfig& raylibConfig, float deltaTime)
+{
+	m_velocity = steer(sums, simConfig);
+
+	// Edge turning, the periodic boundary wraps instead
+	if (raylibConfig.boundary == Boundary::Turn)
+	{
+		int marginX = raylibConfig.MarginX;
+		int marginY = raylibConfig.MarginY;
+		int marginZ = raylibConfig.MarginZ;
+		float tf = simConfig.turnFactor;
+		if (m_position.x > raylibConfig.containerWidth / 2 - marginX)
+			m_velocity.x -= tf;
+		
+		if (m_position.x < -raylibConfig.containerWidth / 2 + marginX)
+			m_velocity.x += tf;
+		
+		if (m_position.y > raylibConfig.containerHeight / 2 - marginY)
+			m_velocity.y -= tf;
+		
+		if (m_position.y < -raylibConfig.containerHeight / 2 + marginY)
+			m_velocity.y += tf;
+		
+		if (m_position.z > raylibConfig.containerDepth / 2 - marginZ)
+			m_velocity.z -= tf;
+		
+		if (m_position.z < -raylibConfig.containerDepth / 2 + marginZ)
+			m_velocity.z += tf;
+	}
 	
 	// Speed limit 
 	float speed = Vector3Length(m_velocity);
-	float maxSpeed = m_simulationConfig.maxSpeed;
-	float minSpeed = m_simulationConfig.minSpeed;
+	float maxSpeed = simConfig.maxSpeed;
+	float minSpeed = simConfig.minSpeed;
 	if (speed > maxSpeed)
 	{
 		m_velocity.x *= maxSpeed / speed;
@@ -129,17 +231,86 @@ void Fish::update(const std::vector<Fish>& fishes)
 	}
 
 	// Update position
-	m_position.x += m_velocity.x * m_raylibConfig.deltaTime;
-	m_position.y += m_velocity.y * m_raylibConfig.deltaTime;
-	m_position.z += m_velocity.z * m_raylibConfig.deltaTime;
+	m_position.x += m_velocity.x * deltaTime;
+	m_position.y += m_velocity.y * deltaTime;
+	m_position.z += m_velocity.z * deltaTime;
+};
+
+void Fish::wrap(const RaylibConfig& raylibConfig)
+{
+	// Fold the position back into the container
+	m_position.x -= raylibConfig.containerWidth * std::floor(m_position.x / raylibConfig.containerWidth + 0.5f);
+	m_position.y -= raylibConfig.containerHeight * std::floor(m_position.y / raylibConfig.containerHeight + 0.5f);
+	m_position.z -= raylibConfig.containerDepth * std::floor(m_position.z / raylibConfig.containerDepth + 0.5f);
 };
 
-void Fish::setSimulationConfig(SimulationConfig simConfig)
+void Fish::setMotion(Vector3 position, Vector3 velocity)
 {
-	m_simulationConfig = simConfig;
+	m_position = position;
+	m_velocity = velocity;
 };
 
-void Fish::setRaylibConfig(RaylibConfig raylibConfig)
+// Walls, speed limits and integration for a range of fish, in place. The rules left each fish's steered
+// velocity in velocities; every fish runs the same branch-free code whatever its position or species.
+// The integration loop, growing school bounds from each fish's new state and storing it in the packed
+// copy as it is written when asked to
+template <bool growBounds, bool storePacked>
+void Fish::integrateRange(Fish* fishes, const Vector3* velocities, const SimulationConfig* speciesConfigs, Vector3 highWall, float deltaTime, int begin, int end, SchoolClusters* clusters, PackedFishes* packed)
 {
-	m_raylibConfig = raylibConfig;
+	for (int i = begin; i < end; i++)
+	{
+		Fish& fish = fishes[i];
+		const SimulationConfig& simConfig = speciesConfigs[fish.m_species];
+		const Vector3 position = fish.m_position;
+
+		// Edge turning, the comparisons become 0/1 factors
+		const float tf = simConfig.turnFactor;
+		float x = velocities[i].x + tf * (static_cast<float>(position.x < -highWall.x) - static_cast<float>(position.x > highWall.x));
+		float y = velocities[i].y + tf * (static_cast<float>(position.y < -highWall.y) - static_cast<float>(position.y > highWall.y));
+		float z = velocities[i].z + tf * (static_cast<float>(position.z < -highWall.z) - static_cast<float>(position.z > highWall.z));
+
+		// Speed limit with one reciprocal square root, clamped by value so it compiles to min/max
+		const float speedSqr = x * x + y * y + z * z + 1e-12f;
+		const float inverseSpeed = 1.0f / std::sqrt(speedSqr);
+		float speed = speedSqr * inverseSpeed;
+		speed = speed < simConfig.minSpeed ? simConfig.minSpeed : speed;
+		speed = speed > simConfig.maxSpeed ? simConfig.maxSpeed : speed;
+		const float scale = speed * inverseSpeed;
+		x *= scale;
+		y *= scale;
+		z *= scale;
+
+		// Update position
+		fish.m_velocity = Vector3{ x, y, z };
+		fish.m_position = Vector3{ position.x + x * deltaTime, position.y + y * deltaTime, position.z + z * deltaTime };
+		if (growBounds)
+			clusters->grow(i, fish.m_position, fish.m_velocity);
+		if (storePacked)
+			packed->store(i, fish.m_position, fish.m_velocity, fish.m_species);
+	}
+}
+
+void Fish::integrate(Fish* fishes, const Vector3* velocities, const SimulationConfig* speciesConfigs, const RaylibConfig& raylibConfig, float deltaTime, int begin, int end, SchoolClusters* clusters, PackedFishes* packed)
+{
+	// The periodic boundary wraps instead of turning, pushing the walls out to infinity keeps the same code path
+	Vector3 highWall{ INFINITY, INFINITY, INFINITY };
+	if (raylibConfig.boundary == Boundary::Turn)
+	{
+		highWall.x = raylibConfig.containerWidth / 2 - raylibConfig.MarginX;
+		highWall.y = raylibConfig.containerHeight / 2 - raylibConfig.MarginY;
+		highWall.z = raylibConfig.containerDepth / 2 - raylibConfig.MarginZ;
+	}
+
+	// Bounds and the packed copy are filled from the state just written so they cost no second sweep
+	if (clusters)
+	{
+		if (packed)
+			integrateRange<true, true>(fishes, velocities, speciesConfigs, highWall, deltaTime, begin, end, clusters, packed);
+		else
+			integrateRange<true, false>(fishes, velocities, speciesConfigs, highWall, deltaTime, begin, end, clusters, packed);
+	}
+	else if (packed)
+		integrateRange<false, true>(fishes, velocities, speciesConfigs, highWall, deltaTime, begin, end, clusters, packed);
+	else
+		integrateRange<false, false>(fishes, velocities, speciesConfigs, highWall, deltaTime, begin, end, clusters, packed);
 }
@@ -1,6 +1,14 @@
 #pragma once
 #include "raylib.h"
 #include <vector>
+#include <cmath>
+
+// What happens at the container walls: fish turn back inside the margins, or leave through one face
+// and come back through the opposite one
+enum class Boundary {
+	Turn,
+	Periodic,
+};
 
 struct RaylibConfig {
 	float containerHeight{};
@@ -9,7 +17,7 @@ struct RaylibConfig {
 	float MarginX{};
 	float MarginY{};
 	float MarginZ{};
-	float deltaTime{};
+	Boundary boundary{ Boundary::Turn };
 };
 
 struct SimulationConfig {
@@ -22,23 +30,56 @@ struct SimulationConfig {
 	float turnFactor{};
 	float maxSpeed{};
 	float minSpeed{};
+	int topologicalNeighbors{};
+	float noiseFactor{};
+};
+
+// How strongly a fish reacts to a fish of another species, per rule
+struct SpeciesWeights {
+	float seperation{ 1.0f };
+	float alignment{ 1.0f };
+	float cohesion{ 1.0f };
 };
 
+// Raw neighbor accumulations for the three rules; averages are taken in Fish::update.
+// Weights are neighbor counts unless species weights scale them. The nearest neighbor distance and
+// the count of links written by gather feed the step statistics.
+struct NeighborSums {
+	Vector3 closeVel{};
+	Vector3 velocitySum{};
+	Vector3 positionSum{};
+	float alignmentWeight{};
+	float cohesionWeight{};
+	Vector3 steering{};
+	float nearestDistance{ INFINITY };
+	int linkCount{};
+};
+
+class PackedFishes;
+class SchoolClusters;
+
 class Fish
 {
 private:
 	Vector3 m_position{};
 	Vector3 m_velocity{};
 	Color m_color{};
-	static SimulationConfig m_simulationConfig;
-	static RaylibConfig m_raylibConfig;
+	int m_species{};
+
+	template <bool growBounds, bool storePacked>
+	static void integrateRange(Fish* fishes, const Vector3* velocities, const SimulationConfig* speciesConfigs, Vector3 highWall, float deltaTime, int begin, int end, SchoolClusters* clusters, PackedFishes* packed);
 
 public:
-	Fish(Vector3 pos, Vector3 vel);
+	Fish(Vector3 pos, Vector3 vel, int species = 0);
 	Vector3 getPosition() const;
 	Vector3 getVelocity() const;
 	Color getColor() const;
-	void update(const std::vector<Fish>& birds);
-	static void setSimulationConfig(SimulationConfig simConfig);
-	static void setRaylibConfig(RaylibConfig raylibConfig);
+	int getSpecies() const;
+	NeighborSums gather(const std::vector<Fish>& fishes, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts, const SimulationConfig& simConfig, const SpeciesWeights* speciesWeights, int* links) const;
+	NeighborSums gather(const PackedFishes& fishes, int self, const int* neighbors, const unsigned char* images, int neighborCount, const Vector3* imageShifts, const SimulationConfig& simConfig, const SpeciesWeights* speciesWeights, int* links) const;
+	Vector3 steer(const NeighborSums& sums, const SimulationConfig& simConfig) const;
+	void update(const NeighborSums& sums, const SimulationConfig& simConfig, const RaylibConfig& raylibConfig, float deltaTime);
+	void wrap(const RaylibConfig& raylibConfig);
+	void setMotion(Vector3 position, Vector3 velocity);
+	static void integrate(Fish* fishes, const Vector3* velocities, const SimulationConfig* speciesConfigs, const RaylibConfig& raylibConfig, float deltaTime, int begin, int end, SchoolClusters* clusters, PackedFishes* packed);
 };
\ No newline at end of file
@@ -0,0 +1,607 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Flock.h"
+#include "HugePages.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <functional>
+#include <memory>
+
+// Below this many fish per thread waking threads costs more than it saves
+static const int minFishPerWorker = 1024;
+
+Flock::Flock(const SimulationConfig& simConfig, const RaylibConfig& raylibConfig, float neighborSkin)
+	: m_speciesConfigs{ simConfig }, m_speciesWeights(1), m_raylibConfig{ raylibConfig }, m_neighborSkin{ neighborSkin }, m_nearest(maxNearestNeighbors),
+	m_workerCount{ static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)) }, m_pool{ std::make_unique<WorkerPool>() }, m_workers(1) {};
+
+const std::vector<Fish>& Flock::getFishes() const
+{
+	return m_fishes;
+}
+
+const std::vector<Fish>& Flock::getPredators() const
+{
+	return m_predators.getPredators();
+}
+
+const SignedDistanceField& Flock::getObstacles() const
+{
+	return m_obstacles;
+}
+
+SignedDistanceField& Flock::getObstacles()
+{
+	return m_obstacles;
+}
+
+const ObstacleBVH& Flock::getMovingObstacles() const
+{
+	return m_movingObstacles;
+}
+
+ObstacleBVH& Flock::getMovingObstacles()
+{
+	return m_movingObstacles;
+}
+
+const SimulationConfig& Flock::getSimulationConfig(int species) const
+{
+	return m_speciesConfigs[species];
+}
+
+int Flock::getSpeciesCount() const
+{
+	return static_cast<int>(m_speciesConfigs.size());
+}
+
+const SpeciesWeights& Flock::getSpeciesWeights(int species, int other) const
+{
+	return m_speciesWeights[species * getSpeciesCount() + other];
+}
+
+const PredatorConfig& Flock::getPredatorConfig() const
+{
+	return m_predators.getConfig();
+}
+
+float Flock::getNeighborSkin() const
+{
+	return m_neighborSkin;
+}
+
+unsigned long long Flock::getStepCount() const
+{
+	return m_stepCount;
+}
+
+const RaylibConfig& Flock::getRaylibConfig() const
+{
+	return m_raylibConfig;
+}
+
+NeighborSearch Flock::getNeighborSearch() const
+{
+	return m_neighborSearch;
+}
+
+int Flock::getHashedCellCount() const
+{
+	return m_hashedGrid.getOccupiedCells();
+}
+
+const Random& Flock::getRandom() const
+{
+	return m_random;
+}
+
+const StepStats& Flock::getStats() const
+{
+	return m_stats.getStats();
+}
+
+const SchoolClusters& Flock::getClusters() const
+{
+	return m_clusters;
+}
+
+int Flock::getCapacity() const
+{
+	return m_capacity;
+}
+
+bool Flock::getCompactStorage() const
+{
+	return m_compactStorage;
+}
+
+float Flock::interactionRadius() const
+{
+	float radius = 0.0f;
+	for (const SimulationConfig& simConfig : m_speciesConfigs)
+		radius = std::max({ radius, simConfig.seperationRadius, simConfig.alignmentRadius, simConfig.cohesionRadius });
+	return radius;
+}
+
+void Flock::setSimulationConfig(const SimulationConfig& simConfig, int species)
+{
+	m_speciesConfigs[species] = simConfig;
+}
+
+int Flock::addSpecies(const SimulationConfig& simConfig)
+{
+	// Grow the species matrix by a row and a column, new pairs react fully to each other
+	const int oldCount = getSpeciesCount();
+	const int newCount = oldCount + 1;
+	std::vector<SpeciesWeights> weights(newCount * newCount);
+	for (int a = 0; a < oldCount; a++)
+		for (int b = 0; b < oldCount; b++)
+			weights[a * newCount + b] = m_speciesWeights[a * oldCount + b];
+	m_speciesWeights = weights;
+	m_speciesConfigs.push_back(simConfig);
+	return oldCount;
+}
+
+void Flock::setSpeciesWeights(int species, int other, const SpeciesWeights& weights)
+{
+	m_speciesWeights[species * getSpeciesCount() + other] = weights;
+}
+
+void Flock::setSpecies(const std::vector<SimulationConfig>& speciesConfigs, const std::vector<SpeciesWeights>& speciesWeights)
+{
+	// Replaces every species at once, the matrix is speciesConfigs.size() squared
+	m_speciesConfigs = speciesConfigs;
+	m_speciesWeights = speciesWeights;
+}
+
+void Flock::setNeighborSkin(float neighborSkin)
+{
+	m_neighborSkin = neighborSkin;
+}
+
+void Flock::setStepCount(unsigned long long stepCount)
+{
+	m_stepCount = stepCount;
+}
+
+void Flock::setRaylibConfig(const RaylibConfig& raylibConfig)
+{
+	// The grids are laid out over the container
+	m_raylibConfig = raylibConfig;
+	m_neighborListDirty = true;
+}
+
+void Flock::setNeighborSearch(NeighborSearch neighborSearch)
+{
+	if (neighborSearch != m_neighborSearch)
+		m_neighborListDirty = true;
+	m_neighborSearch = neighborSearch;
+}
+
+void Flock::setWorkerCount(int workerCount)
+{
+	m_workerCount = std::max(workerCount, 1);
+}
+
+void Flock::setRandom(const Random& random)
+{
+	m_random = random;
+}
+
+void Flock::setPredatorConfig(const PredatorConfig& predatorConfig)
+{
+	m_predators.setConfig(predatorConfig);
+}
+
+void Flock::setStatsEnabled(bool statsEnabled)
+{
+	m_statsEnabled = statsEnabled;
+}
+
+void Flock::setClusteringEnabled(bool clusteringEnabled)
+{
+	m_clusteringEnabled = clusteringEnabled;
+}
+
+void Flock::setCompactStorage(bool compactStorage)
+{
+	// Integration only stores the packed copy while compact storage is on
+	m_compactStorage = compactStorage;
+	m_packedCurrent = false;
+}
+
+void Flock::assignHandles()
+{
+	// Give every fish appended since the last call a slot, reusing freed ones first
+	for (int i = static_cast<int>(m_fishSlots.size()); i < static_cast<int>(m_fishes.size()); i++)
+	{
+		int slot = static_cast<int>(m_slotFish.size());
+		if (m_freeSlots.empty())
+		{
+			m_slotFish.push_back(i);
+			m_slotGenerations.push_back(0);
+		}
+		else
+		{
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			m_slotFish[slot] = i;
+		}
+		m_fishSlots.push_back(slot);
+	}
+	m_clusters.clear();
+}
+
+void Flock::reserve(int fishCount)
+{
+	// The fish themselves are the largest array and are streamed every step, so they get huge pages
+	if (fishCount <= m_capacity)
+		return;
+	m_capacity = fishCount;
+	m_fishes.reserve(fishCount);
+	adviseHugePages(m_fishes.data(), m_fishes.capacity() * sizeof(Fish));
+	m_fishSlots.reserve(fishCount);
+	m_slotFish.reserve(fishCount);
+	m_slotGenerations.reserve(fishCount);
+	m_freeSlots.reserve(fishCount);
+	m_steered.reserve(fishCount);
+	adviseHugePages(m_steered.data(), m_steered.capacity() * sizeof(Vector3));
+	m_neighborList.reserve(fishCount);
+	m_grid.reserve(fishCount);
+	m_clusters.reserve(fishCount);
+	m_packed.reserve(fishCount);
+}
+
+FishHandle Flock::addFish(const Fish& fish)
+{
+	if (m_capacity > 0 && static_cast<int>(m_fishes.size()) >= m_capacity)
+		return FishHandle{};
+	m_fishes.push_back(fish);
+	m_packedCurrent = false;
+	assignHandles();
+	return handleOf(static_cast<int>(m_fishes.size()) - 1);
+}
+
+void Flock::spawn(int count, const SpawnConfig& spawnConfig)
+{
+	if (m_capacity > 0)
+		count = std::min(count, m_capacity - static_cast<int>(m_fishes.size()));
+	spawnFishes(m_fishes, count, spawnConfig);
+	m_packedCurrent = false;
+	assignHandles();
+}
+
+FishHandle Flock::handleOf(int index) const
+{
+	const int slot = m_fishSlots[index];
+	return FishHandle{ slot, m_slotGenerations[slot] };
+}
+
+int Flock::indexOf(FishHandle handle) const
+{
+	if (handle.slot < 0 || handle.slot >= static_cast<int>(m_slotFish.size()) || m_slotGenerations[handle.slot] != handle.generation)
+		return -1;
+	return m_slotFish[handle.slot];
+}
+
+bool Flock::removeFish(FishHandle handle)
+{
+	const int index = indexOf(handle);
+	if (index < 0)
+		return false;
+
+	// Swap and pop: the last fish takes over the index, its slot is pointed at the new place
+	const int last = static_cast<int>(m_fishes.size()) - 1;
+	m_grid.swapRemove(index, last + 1);
+	m_hashedGrid.swapRemove(index, last + 1);
+	if (!m_neighborList.swapRemove(index, last + 1))
+		m_neighborListDirty = true;
+	if (m_packedCurrent)
+		m_packed.swapRemove(index);
+	m_fishes[index] = m_fishes[last];
+	m_fishSlots[index] = m_fishSlots[last];
+	m_slotFish[m_fishSlots[index]] = index;
+	m_fishes.pop_back();
+	m_fishSlots.pop_back();
+
+	// Bumping the generation makes every copy of the handle stale
+	m_slotFish[handle.slot] = -1;
+	m_slotGenerations[handle.slot]++;
+	m_freeSlots.push_back(handle.slot);
+
+	// The neighbor list remaps its rows before the next step, the school labels are recomputed
+	m_clusters.clear();
+	return true;
+}
+
+void Flock::addPredator(const Fish& predator)
+{
+	m_predators.add(predator);
+}
+
+void Flock::clear()
+{
+	for (int slot : m_fishSlots)
+	{
+		m_slotFish[slot] = -1;
+		m_slotGenerations[slot]++;
+		m_freeSlots.push_back(slot);
+	}
+	m_fishSlots.clear();
+	m_fishes.clear();
+	m_packedCurrent = false;
+	m_predators.clear();
+	m_clusters.clear();
+}
+
+size_t Flock::getScratchHighWater() const
+{
+	size_t highWater = m_scratch.getHighWater();
+	for (const StepWorker& worker : m_workers)
+		highWater += worker.scratch.getHighWater();
+	return highWater;
+}
+
+void Flock::beginScratch()
+{
+	// Whatever the last step took is dropped at once, every worker starts with room for a full neighborhood
+	m_workers.resize(std::max(m_workerCount, 1));
+	m_scratch.reset();
+	for (StepWorker& worker : m_workers)
+	{
+		worker.scratch.reset();
+		worker.links = worker.scratch.allocate<int>(maxNearestNeighbors);
+		worker.linkCapacity = maxNearestNeighbors;
+	}
+}
+
+void Flock::wrapFishes()
+{
+	// Fish only wrap while an index is rebuilt, between rebuilds they may swim a little past a face
+	// and the neighbor list keeps seeing them through the image it was built with
+	if (m_raylibConfig.boundary != Boundary::Periodic)
+		return;
+	for (Fish& fish : m_fishes)
+		fish.wrap(m_raylibConfig);
+	m_packedCurrent = false;
+}
+
+float Flock::topSpeed() const
+{
+	float speed = 0.0f;
+	for (const SimulationConfig& simConfig : m_speciesConfigs)
+		speed = std::max(speed, simConfig.maxSpeed);
+	return speed;
+}
+
+void Flock::lookAhead()
+{
+	// Moving obstacles are refitted where they are now, then every fish casts along its heading in one batch.
+	// Fish keep half their separation distance clear of the obstacles.
+	m_lookAheadHits = nullptr;
+	m_movingObstacles.update();
+	if (m_movingObstacles.empty())
+		return;
+	const float castRadius = m_speciesConfigs[0].seperationRadius * 0.5f;
+
+	// Schools further from every obstacle than a fish looks ahead are not cast for at all
+	const std::vector<int>& clusterIds = m_clusters.getClusterIds();
+	const std::vector<ClusterBounds>& schools = m_clusters.getBounds();
+	const bool cullSchools = clusterIds.size() == m_fishes.size() && !schools.empty();
+	unsigned char* schoolsNearObstacles = nullptr;
+	if (cullSchools)
+	{
+		const BoundingBox obstacles = m_movingObstacles.getBounds();
+		const float reach = m_movingObstacles.getConfig().avoidDistance + castRadius;
+		schoolsNearObstacles = m_scratch.allocate<unsigned char>(static_cast<int>(schools.size()));
+		for (size_t c = 0; c < schools.size(); c++)
+		{
+			const Vector3 closest = Vector3Clamp(schools[c].center, obstacles.min, obstacles.max);
+			const float range = schools[c].radius + reach;
+			schoolsNearObstacles[c] = Vector3DistanceSqr(closest, schools[c].center) <= range * range;
+		}
+	}
+	const int fishCount = static_cast<int>(m_fishes.size());
+	int* lookAheadFish = m_scratch.allocate<int>(fishCount);
+	Ray* rays = m_scratch.allocate<Ray>(fishCount);
+	int rayCount = 0;
+	for (int i = 0; i < fishCount; i++)
+	{
+		if (cullSchools && !schoolsNearObstacles[clusterIds[i]])
+			continue;
+		lookAheadFish[rayCount] = i;
+		rays[rayCount++] = Ray{ m_fishes[i].getPosition(), Vector3Normalize(m_fishes[i].getVelocity()) };
+	}
+	RayHit* castHits = m_scratch.allocate<RayHit>(rayCount);
+	m_movingObstacles.sphereCast(rays, rayCount, castRadius, castHits, *m_pool, m_workerCount);
+	m_lookAheadHits = m_scratch.allocate<RayHit>(fishCount);
+	std::uninitialized_fill_n(m_lookAheadHits, fishCount, RayHit{});
+	for (int r = 0; r < rayCount; r++)
+		m_lookAheadHits[lookAheadFish[r]] = castHits[r];
+}
+
+void Flock::steerFish(int index, NeighborSums sums, const SimulationConfig& simConfig, StepWorker& worker)
+{
+	const Fish& fish = m_fishes[index];
+	const Vector3 position = fish.getPosition();
+	sums.steering = Vector3Add(m_predators.flee(position), m_obstacles.avoid(position));
+	if (m_lookAheadHits)
+		sums.steering = Vector3Add(sums.steering, m_movingObstacles.avoid(m_lookAheadHits[index]));
+	if (simConfig.noiseFactor > 0.0f)
+	{
+		// Noise is numbered by step and fish, so it does not depend on which thread or order fish are steered in
+		unsigned bits[4];
+		m_random.block((m_stepCount << 32) | static_cast<unsigned>(index), bits);
+		const float scale = simConfig.noiseFactor / 2147483648.0f;
+		Vector3 noise{ (static_cast<float>(bits[0]) - 2147483648.0f) * scale, (static_cast<float>(bits[1]) - 2147483648.0f) * scale, (static_cast<float>(bits[2]) - 2147483648.0f) * scale };
+		sums.steering = Vector3Add(sums.steering, noise);
+	}
+	m_steered[index] = fish.steer(sums, simConfig);
+
+	// Statistics and schools use what gather left behind, the octree aggregates pairs and links nothing
+	if (m_statsEnabled)
+		worker.stats.addFish(fish.getVelocity(), sums.nearestDistance);
+	if (m_linking)
+		m_clusters.link(index, worker.links, sums.linkCount);
+}
+
+void Flock::steerNeighbors(int begin, int end, StepWorker& worker)
+{
+	// Outside periodic mode every image is the container itself, gather then skips the shift
+	const int speciesCount = getSpeciesCount();
+	const bool periodic = m_raylibConfig.boundary == Boundary::Periodic;
+	for (int i = begin; i < end; i++)
+	{
+		const int species = m_fishes[i].getSpecies();
+		const SimulationConfig& simConfig = m_speciesConfigs[species];
+		const int neighborCount = m_neighborList.neighborCount(i);
+		if (m_linking && neighborCount > worker.linkCapacity)
+		{
+			worker.linkCapacity = std::max(neighborCount, worker.linkCapacity * 2);
+			worker.links = worker.scratch.allocate<int>(worker.linkCapacity);
+		}
+		const SpeciesWeights* speciesWeights = &m_speciesWeights[species * speciesCount];
+		const unsigned char* images = periodic ? m_neighborList.images(i) : nullptr;
+		int* links = m_linking ? worker.links : nullptr;
+		NeighborSums sums = m_compactStorage
+			? m_fishes[i].gather(m_packed, i, m_neighborList.neighbors(i), images, neighborCount, m_neighborList.imageShifts(), simConfig, speciesWeights, links)
+			: m_fishes[i].gather(m_fishes, m_neighborList.neighbors(i), images, neighborCount, m_neighborList.imageShifts(), simConfig, speciesWeights, links);
+		steerFish(i, sums, simConfig, worker);
+	}
+}
+
+void Flock::integrate(float deltaTime)
+{
+	// Every fish was steered from the same snapshot, one pass then moves them all in place
+	const int fishCount = static_cast<int>(m_fishes.size());
+	PackedFishes* packed = nullptr;
+	if (m_compactStorage)
+	{
+		m_packed.prepare(fishCount, m_raylibConfig, topSpeed());
+		packed = &m_packed;
+	}
+	m_packedCurrent = m_compactStorage;
+	if (!m_linking)
+	{
+		Fish::integrate(m_fishes.data(), m_steered.data(), m_speciesConfigs.data(), m_raylibConfig, deltaTime, 0, fishCount, nullptr, packed);
+		return;
+	}
+	m_clusters.beginBounds();
+	Fish::integrate(m_fishes.data(), m_steered.data(), m_speciesConfigs.data(), m_raylibConfig, deltaTime, 0, fishCount, &m_clusters, packed);
+	m_clusters.finishBounds();
+}
+
+void Flock::finishStep(float deltaTime)
+{
+	// Aggregates are complete once every fish was steered, schools are labeled before
+	// integration so their bounds follow the fish as they move
+	const int fishCount = static_cast<int>(m_fishes.size());
+	if (m_linking)
+		m_clusters.label();
+	integrate(deltaTime);
+	if (m_statsEnabled)
+	{
+		m_stats = m_workers[0].stats;
+		for (size_t w = 1; w < m_workers.size(); w++)
+			m_stats.merge(m_workers[w].stats);
+		m_stats.finish(fishCount, m_linking ? m_clusters.getClusterCount() : fishCount);
+	}
+}
+
+void Flock::step(float deltaTime)
+{
+	const int fishCount = static_cast<int>(m_fishes.size());
+	const int speciesCount = getSpeciesCount();
+
+	// Predators move once the school's index is up to date, before any fish steers, so the school
+	// reacts to where they are now
+	beginScratch();
+	lookAhead();
+	m_steered.resize(fishCount);
+	m_stepCount++;
+	if (m_statsEnabled)
+	{
+		for (StepWorker& worker : m_workers)
+			worker.stats.begin(m_stepCount, interactionRadius());
+	}
+	m_linking = m_statsEnabled || m_clusteringEnabled;
+	if (m_linking)
+		m_clusters.begin(fishCount);
+
+	// Topological mode: rules act on the k nearest fish.
+	// Species without their own k take the largest one and keep their radii within that set.
+	// Neither this search nor the octree looks across a periodic face, fish still wrap around.
+	int maxTopologicalNeighbors = 0;
+	for (const SimulationConfig& simConfig : m_speciesConfigs)
+		maxTopologicalNeighbors = std::max(maxTopologicalNeighbors, simConfig.topologicalNeighbors);
+	if (maxTopologicalNeighbors > 0)
+	{
+		// Size cells to hold about k fish on average so a search touches only a few shells
+		const float volume = m_raylibConfig.containerWidth * m_raylibConfig.containerHeight * m_raylibConfig.containerDepth;
+		const float volumePerFish = volume / std::max(fishCount, 1);
+		wrapFishes();
+		m_nearestGrid.build(m_fishes, m_raylibConfig, std::cbrt(volumePerFish * maxTopologicalNeighbors));
+		m_predators.hunt(m_fishes, m_nearestGrid, 0.0f, m_raylibConfig, m_speciesConfigs[0].turnFactor, deltaTime);
+		for (int i = 0; i < fishCount; i++)
+		{
+			const int species = m_fishes[i].getSpecies();
+			const SimulationConfig& simConfig = m_speciesConfigs[species];
+			const int k = simConfig.topologicalNeighbors > 0 ? simConfig.topologicalNeighbors : maxTopologicalNeighbors;
+			int nearestCount = m_nearestGrid.nearest(i, k, m_fishes, m_nearest.data());
+			NeighborSums sums = m_fishes[i].gather(m_fishes, m_nearest.data(), nullptr, nearestCount, nullptr, simConfig, &m_speciesWeights[species * speciesCount], m_linking ? m_workers[0].links : nullptr);
+			steerFish(i, sums, simConfig, m_workers[0]);
+		}
+		finishStep(deltaTime);
+		m_neighborListDirty = true;
+		return;
+	}
+
+	// Octree far-field for radii approaching the container size. Aggregates mix all species,
+	// so the species matrix does not apply here.
+	if (m_neighborSearch == NeighborSearch::Octree)
+	{
+		wrapFishes();
+		m_octree.build(m_fishes);
+		m_predators.hunt(m_fishes, m_octree, 0.0f, m_raylibConfig, m_speciesConfigs[0].turnFactor, deltaTime);
+		for (int i = 0; i < fishCount; i++)
+		{
+			const SimulationConfig& simConfig = m_speciesConfigs[m_fishes[i].getSpecies()];
+			steerFish(i, m_octree.query(i, m_fishes, simConfig), simConfig, m_workers[0]);
+		}
+		finishStep(deltaTime);
+		m_neighborListDirty = true;
+		return;
+	}
+
+	// Refresh neighbor list once fish have drifted out of the skin
+	const float cutoff = interactionRadius();
+	SpatialIndex& index = m_neighborSearch == NeighborSearch::HashedGrid ? static_cast<SpatialIndex&>(m_hashedGrid) : m_grid;
+	if (!m_neighborListDirty)
+		m_neighborList.applyRemovals();
+	if (m_neighborListDirty || m_neighborList.needsRebuild(m_fishes, cutoff, m_neighborSkin))
+	{
+		wrapFishes();
+		m_neighborList.build(m_fishes, index, m_raylibConfig, cutoff, m_neighborSkin);
+		m_neighborListDirty = false;
+	}
+
+	// Fish have moved at most half the skin since the index was built
+	m_predators.hunt(m_fishes, index, m_neighborSkin * 0.5f, m_raylibConfig, m_speciesConfigs[0].turnFactor, deltaTime);
+	// Integration left the packed copy current unless fish were added or wrapped since, or its scales moved
+	if (m_compactStorage && (!m_packedCurrent || !m_packed.fits(m_raylibConfig, topSpeed())))
+		m_packed.pack(m_fishes, m_raylibConfig, topSpeed());
+
+	// Every fish reads the same snapshot and writes only its own motion, so contiguous chunks are
+	// steered on the pool's threads, the calling thread taking the last one
+	const int workerCount = std::clamp(m_workerCount, 1, std::max(fishCount / minFishPerWorker, 1));
+	if (workerCount == 1)
+		steerNeighbors(0, fishCount, m_workers[0]);
+	else
+	{
+		const int chunk = (fishCount + workerCount - 1) / workerCount;
+		auto steerChunk = [&](int w) { steerNeighbors(std::min(w * chunk, fishCount), std::min((w + 1) * chunk, fishCount), m_workers[w]); };
+		m_pool->run(workerCount, steerChunk);
+	}
+	finishStep(deltaTime);
+}
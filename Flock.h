@@ -0,0 +1,150 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "NeighborList.h"
+#include "SpatialGrid.h"
+#include "IncrementalGrid.h"
+#include "HashedGrid.h"
+#include "Octree.h"
+#include "Predators.h"
+#include "SignedDistanceField.h"
+#include "ObstacleBVH.h"
+#include "Spawn.h"
+#include "Random.h"
+#include "StepStats.h"
+#include "SchoolClusters.h"
+#include "ScratchArena.h"
+#include "PackedFishes.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <memory>
+
+enum class NeighborSearch {
+	DenseGrid,
+	HashedGrid,
+	Octree,
+};
+
+// Stable reference to a fish. Removing a fish moves the last fish into its index, so indices are only
+// good for one step; a handle follows its fish and goes stale once the fish is removed.
+struct FishHandle {
+	int slot{ -1 };
+	unsigned generation{};
+};
+
+// A school of fish together with its configuration and search structures.
+// Flocks share no state, so independent flocks can be stepped on different threads.
+// Fish of every species share one spatial index; each species has its own SimulationConfig and
+// a row in the species matrix weighting how it reacts to every other species.
+// A flock given a capacity with reserve() holds at most that many fish: every array indexed by fish
+// is allocated up front, and fish past the capacity are not added, so spawning never reallocates.
+// With compact storage on, the neighbor list loop reads a reduced-precision copy of the fish that
+// integration stores as it moves them; the topological and octree searches always read full precision.
+class Flock
+{
+private:
+	// Scratch of one thread steering a range of fish, its arena is only touched by that thread
+	struct StepWorker {
+		ScratchArena scratch;
+		int* links{};
+		int linkCapacity{};
+		StepStatsAccumulator stats;
+	};
+
+	std::vector<Fish> m_fishes;
+	std::vector<int> m_fishSlots;
+	std::vector<int> m_slotFish;
+	std::vector<unsigned> m_slotGenerations;
+	std::vector<int> m_freeSlots;
+	std::vector<SimulationConfig> m_speciesConfigs;
+	std::vector<SpeciesWeights> m_speciesWeights;
+	RaylibConfig m_raylibConfig{};
+	NeighborSearch m_neighborSearch{ NeighborSearch::DenseGrid };
+	float m_neighborSkin{};
+	bool m_neighborListDirty{ true };
+
+	NeighborList m_neighborList;
+	IncrementalGrid m_grid;
+	HashedGrid m_hashedGrid;
+	SpatialGrid m_nearestGrid;
+	Octree m_octree{ 0.4f, 16 };
+	std::vector<int> m_nearest;
+	Predators m_predators;
+	SignedDistanceField m_obstacles;
+	ObstacleBVH m_movingObstacles;
+	RayHit* m_lookAheadHits{};
+	int m_workerCount{ 1 };
+	std::unique_ptr<WorkerPool> m_pool;
+	ScratchArena m_scratch;
+	std::vector<Vector3> m_steered;
+	Random m_random;
+	unsigned long long m_stepCount{};
+	std::vector<StepWorker> m_workers;
+	StepStatsAccumulator m_stats;
+	bool m_statsEnabled{};
+	SchoolClusters m_clusters;
+	bool m_clusteringEnabled{};
+	int m_capacity{};
+	PackedFishes m_packed;
+	bool m_compactStorage{};
+	bool m_packedCurrent{};
+	bool m_linking{};
+
+	void assignHandles();
+	void beginScratch();
+	void wrapFishes();
+	float topSpeed() const;
+	void lookAhead();
+	void steerFish(int index, NeighborSums sums, const SimulationConfig& simConfig, StepWorker& worker);
+	void steerNeighbors(int begin, int end, StepWorker& worker);
+	void integrate(float deltaTime);
+	void finishStep(float deltaTime);
+
+public:
+	Flock(const SimulationConfig& simConfig, const RaylibConfig& raylibConfig, float neighborSkin);
+	const std::vector<Fish>& getFishes() const;
+	const std::vector<Fish>& getPredators() const;
+	const SignedDistanceField& getObstacles() const;
+	SignedDistanceField& getObstacles();
+	const ObstacleBVH& getMovingObstacles() const;
+	ObstacleBVH& getMovingObstacles();
+	const SimulationConfig& getSimulationConfig(int species = 0) const;
+	int getSpeciesCount() const;
+	const SpeciesWeights& getSpeciesWeights(int species, int other) const;
+	const PredatorConfig& getPredatorConfig() const;
+	float getNeighborSkin() const;
+	unsigned long long getStepCount() const;
+	const RaylibConfig& getRaylibConfig() const;
+	NeighborSearch getNeighborSearch() const;
+	int getHashedCellCount() const;
+	const Random& getRandom() const;
+	const StepStats& getStats() const;
+	const SchoolClusters& getClusters() const;
+	int getCapacity() const;
+	bool getCompactStorage() const;
+	size_t getScratchHighWater() const;
+	float interactionRadius() const;
+	void setSimulationConfig(const SimulationConfig& simConfig, int species = 0);
+	int addSpecies(const SimulationConfig& simConfig);
+	void setSpeciesWeights(int species, int other, const SpeciesWeights& weights);
+	void setSpecies(const std::vector<SimulationConfig>& speciesConfigs, const std::vector<SpeciesWeights>& speciesWeights);
+	void setNeighborSkin(float neighborSkin);
+	void setStepCount(unsigned long long stepCount);
+	void setRaylibConfig(const RaylibConfig& raylibConfig);
+	void setNeighborSearch(NeighborSearch neighborSearch);
+	void setWorkerCount(int workerCount);
+	void setRandom(const Random& random);
+	void setPredatorConfig(const PredatorConfig& predatorConfig);
+	void setStatsEnabled(bool statsEnabled);
+	void setClusteringEnabled(bool clusteringEnabled);
+	void setCompactStorage(bool compactStorage);
+	void reserve(int fishCount);
+	FishHandle addFish(const Fish& fish);
+	FishHandle handleOf(int index) const;
+	int indexOf(FishHandle handle) const;
+	bool removeFish(FishHandle handle);
+	void spawn(int count, const SpawnConfig& spawnConfig);
+	void addPredator(const Fish& predator);
+	void clear();
+	void step(float deltaTime);
+};
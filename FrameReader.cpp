@@ -0,0 +1,90 @@
+#include "FrameReader.h"
+#include "SharedFrames.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+// Summary of one frame, computed straight from the shared arrays
+struct FrameSummary {
+	unsigned long long step{};
+	unsigned fishCount{};
+	float polarization{};
+	float meanSpeed{};
+	float centerX{};
+	float centerY{};
+	float centerZ{};
+};
+
+static FrameSummary summarize(const SharedFrameView& view)
+{
+	FrameSummary summary;
+	summary.step = view.slot->step;
+	summary.fishCount = view.slot->fishCount;
+	double headingX = 0.0, headingY = 0.0, headingZ = 0.0;
+	double speed = 0.0;
+	double centerX = 0.0, centerY = 0.0, centerZ = 0.0;
+	for (unsigned i = 0; i < summary.fishCount; i++)
+	{
+		const float length = std::sqrt(view.velocityX[i] * view.velocityX[i] + view.velocityY[i] * view.velocityY[i] + view.velocityZ[i] * view.velocityZ[i]);
+		if (length > 0.0f)
+		{
+			headingX += view.velocityX[i] / length;
+			headingY += view.velocityY[i] / length;
+			headingZ += view.velocityZ[i] / length;
+		}
+		speed += length;
+		centerX += view.positionX[i];
+		centerY += view.positionY[i];
+		centerZ += view.positionZ[i];
+	}
+	if (summary.fishCount > 0)
+	{
+		// Polarization is the length of the mean heading, 1 when every fish swims the same way
+		const double count = summary.fishCount;
+		summary.polarization = static_cast<float>(std::sqrt(headingX * headingX + headingY * headingY + headingZ * headingZ) / count);
+		summary.meanSpeed = static_cast<float>(speed / count);
+		summary.centerX = static_cast<float>(centerX / count);
+		summary.centerY = static_cast<float>(centerY / count);
+		summary.centerZ = static_cast<float>(centerZ / count);
+	}
+	return summary;
+}
+
+// Prints polarization, mean speed and center of the school for the next frames the viewer publishes.
+// Frames are read in place and thrown away if the publisher overwrote them meanwhile.
+int runFrameReader(int frames)
+{
+	SharedFrameReader reader;
+	while (!reader.open(SharedFrames::defaultName()))
+	{
+		std::cout << "Waiting for the viewer to publish frames (G)" << std::endl;
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+
+	unsigned long long lastFrame = reader.getPublishedCount();
+	int read = 0;
+	int torn = 0;
+	while (read < frames)
+	{
+		SharedFrameView view;
+		if (reader.getPublishedCount() == lastFrame || !reader.latest(view))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		const unsigned long long frame = view.slot->frame;
+		const FrameSummary summary = summarize(view);
+		if (!reader.validate(view))
+		{
+			torn++;
+			continue;
+		}
+		lastFrame = frame + 1;
+		read++;
+		std::cout << "step " << summary.step << ": " << summary.fishCount << " fish, polarization " << summary.polarization
+			<< ", mean speed " << summary.meanSpeed << ", center " << summary.centerX << " " << summary.centerY << " " << summary.centerZ << std::endl;
+	}
+	std::cout << read << " frames read, " << torn << " torn frames skipped" << std::endl;
+	return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Example consumer of the shared frame ring, started from the command line while the viewer publishes
+int runFrameReader(int frames);
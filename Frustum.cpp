@@ -0,0 +1,39 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Frustum.h"
+#include <cmath>
+
+Frustum cameraFrustum(const Camera3D& camera, float aspect, float nearPlane, float farPlane)
+{
+	// Planes come straight out of the rows of the view-projection matrix
+	const Matrix projection = MatrixPerspective(camera.fovy * DEG2RAD, aspect, nearPlane, farPlane);
+	const Matrix clip = MatrixMultiply(MatrixLookAt(camera.position, camera.target, camera.up), projection);
+	const Vector4 rows[4]{
+		{ clip.m0, clip.m4, clip.m8, clip.m12 },
+		{ clip.m1, clip.m5, clip.m9, clip.m13 },
+		{ clip.m2, clip.m6, clip.m10, clip.m14 },
+		{ clip.m3, clip.m7, clip.m11, clip.m15 },
+	};
+	Frustum frustum;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			const float sign = side == 0 ? 1.0f : -1.0f;
+			Vector4 plane{ rows[3].x + sign * rows[axis].x, rows[3].y + sign * rows[axis].y, rows[3].z + sign * rows[axis].z, rows[3].w + sign * rows[axis].w };
+			const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			frustum.planes[axis * 2 + side] = Vector4{ plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+		}
+	}
+	return frustum;
+}
+
+bool sphereVisible(const Frustum& frustum, Vector3 center, float radius)
+{
+	for (const Vector4& plane : frustum.planes)
+	{
+		if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
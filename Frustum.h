@@ -0,0 +1,10 @@
+#pragma once
+#include "raylib.h"
+
+// The six planes of a camera's view volume, normals pointing inwards
+struct Frustum {
+	Vector4 planes[6]{};
+};
+
+Frustum cameraFrustum(const Camera3D& camera, float aspect, float nearPlane, float farPlane);
+bool sphereVisible(const Frustum& frustum, Vector3 center, float radius);
@@ -0,0 +1,162 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "HashedGrid.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+// 21 bits per axis, biased so negative coordinates pack without sign handling
+static const int coordBits = 21;
+static const int64_t coordBias = int64_t{ 1 } << (coordBits - 1);
+static const uint64_t coordMask = (uint64_t{ 1 } << coordBits) - 1;
+// Keys never reach this value, it marks an empty slot
+static const uint64_t emptyKey = ~uint64_t{ 0 };
+
+static uint64_t packKey(int64_t x, int64_t y, int64_t z)
+{
+	return (static_cast<uint64_t>(x + coordBias) & coordMask)
+		| (static_cast<uint64_t>(y + coordBias) & coordMask) << coordBits
+		| (static_cast<uint64_t>(z + coordBias) & coordMask) << (2 * coordBits);
+}
+
+static size_t slotOf(uint64_t key, size_t mask)
+{
+	// Fibonacci hashing spreads neighboring cells over the table
+	return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+uint64_t HashedGrid::keyOf(Vector3 position) const
+{
+	return packKey(
+		static_cast<int64_t>(std::floor(position.x / m_cellSize)),
+		static_cast<int64_t>(std::floor(position.y / m_cellSize)),
+		static_cast<int64_t>(std::floor(position.z / m_cellSize)));
+}
+
+int HashedGrid::find(uint64_t key) const
+{
+	const size_t mask = m_table.size() - 1;
+	for (size_t slot = slotOf(key, mask);; slot = (slot + 1) & mask)
+	{
+		if (m_table[slot].key == key) return static_cast<int>(slot);
+		if (m_table[slot].key == emptyKey) return -1;
+	}
+}
+
+int HashedGrid::findOrInsert(uint64_t key)
+{
+	const size_t mask = m_table.size() - 1;
+	for (size_t slot = slotOf(key, mask);; slot = (slot + 1) & mask)
+	{
+		if (m_table[slot].key == key) return static_cast<int>(slot);
+		if (m_table[slot].key == emptyKey)
+		{
+			m_table[slot].key = key;
+			m_occupiedCells++;
+			return static_cast<int>(slot);
+		}
+	}
+}
+
+void HashedGrid::build(const std::vector<Fish>& fishes, const RaylibConfig&, float minCellSize)
+{
+	// Every fish could sit in its own cell, keep the load factor at or below one half
+	const int fishCount = static_cast<int>(fishes.size());
+	size_t capacity = 16;
+	while (capacity < 2 * fishes.size())
+		capacity *= 2;
+
+	m_cellSize = minCellSize;
+	m_table.assign(capacity, Entry{ emptyKey, 0, 0 });
+	m_indices.resize(fishCount);
+	m_fishEntry.resize(fishCount);
+	m_occupiedCells = 0;
+
+	// Counting sort over table slots: count, prefix sum, scatter
+	for (int i = 0; i < fishCount; i++)
+	{
+		m_fishEntry[i] = findOrInsert(keyOf(fishes[i].getPosition()));
+		m_table[m_fishEntry[i]].count++;
+	}
+	int start = 0;
+	for (Entry& entry : m_table)
+	{
+		entry.start = start;
+		start += entry.count;
+		entry.count = 0;
+	}
+	for (int i = 0; i < fishCount; i++)
+	{
+		Entry& entry = m_table[m_fishEntry[i]];
+		m_indices[entry.start + entry.count++] = i;
+	}
+}
+
+void HashedGrid::query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const
+{
+	// Every cell the query box touches, the 27 around the fish while the radius is within a cell
+	const float radiusSqr = radius * radius;
+	const int64_t minX = static_cast<int64_t>(std::floor((position.x - radius) / m_cellSize));
+	const int64_t minY = static_cast<int64_t>(std::floor((position.y - radius) / m_cellSize));
+	const int64_t minZ = static_cast<int64_t>(std::floor((position.z - radius) / m_cellSize));
+	const int64_t maxX = static_cast<int64_t>(std::floor((position.x + radius) / m_cellSize));
+	const int64_t maxY = static_cast<int64_t>(std::floor((position.y + radius) / m_cellSize));
+	const int64_t maxZ = static_cast<int64_t>(std::floor((position.z + radius) / m_cellSize));
+
+	for (int64_t z = minZ; z <= maxZ; z++)
+	{
+		for (int64_t y = minY; y <= maxY; y++)
+		{
+			for (int64_t x = minX; x <= maxX; x++)
+			{
+				int slot = find(packKey(x, y, z));
+				if (slot < 0) continue;
+				const Entry& entry = m_table[slot];
+				for (int s = entry.start; s < entry.start + entry.count; s++)
+				{
+					int other = m_indices[s];
+					if (Vector3DistanceSqr(position, fishes[other].getPosition()) < radiusSqr)
+						result.push_back(other);
+				}
+			}
+		}
+	}
+}
+
+void HashedGrid::swapRemove(int fishIndex, int fishCount)
+{
+	// Mirrors the school dropping a fish by moving its last fish into the gap, the owner rebuilds on a mismatch
+	if (fishCount != static_cast<int>(m_fishEntry.size()))
+		return;
+
+	// The fish leaves its cell by swapping in the cell's last entry
+	Entry& entry = m_table[m_fishEntry[fishIndex]];
+	const int end = entry.start + entry.count - 1;
+	for (int s = entry.start; s <= end; s++)
+	{
+		if (m_indices[s] != fishIndex) continue;
+		m_indices[s] = m_indices[end];
+		entry.count--;
+		break;
+	}
+
+	// The last fish keeps its cell under the freed index
+	const int last = fishCount - 1;
+	if (fishIndex != last)
+	{
+		const Entry& lastEntry = m_table[m_fishEntry[last]];
+		for (int s = lastEntry.start; s < lastEntry.start + lastEntry.count; s++)
+		{
+			if (m_indices[s] != last) continue;
+			m_indices[s] = fishIndex;
+			break;
+		}
+		m_fishEntry[fishIndex] = m_fishEntry[last];
+	}
+	m_fishEntry.pop_back();
+}
+
+int HashedGrid::getOccupiedCells() const
+{
+	return m_occupiedCells;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+#include <cstdint>
+
+// Sparse grid over unbounded space for ocean-sized containers with few fish.
+// Occupied cells live in an open addressing hash table keyed by their packed integer coordinates,
+// so memory follows the number of occupied cells instead of the container volume.
+class HashedGrid : public SpatialIndex
+{
+private:
+	struct Entry {
+		uint64_t key{};
+		int start{};
+		int count{};
+	};
+
+	float m_cellSize{};
+	std::vector<Entry> m_table;
+	std::vector<int> m_indices;
+	std::vector<int> m_fishEntry;
+	int m_occupiedCells{};
+
+	uint64_t keyOf(Vector3 position) const;
+	int find(uint64_t key) const;
+	int findOrInsert(uint64_t key);
+
+public:
+	void build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize) override;
+	void query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const override;
+	void swapRemove(int fishIndex, int fishCount);
+	int getOccupiedCells() const;
+};
@@ -0,0 +1,22 @@
+#include "HugePages.h"
+#include <cstddef>
+#include <cstdint>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static const uintptr_t hugePageSize = 2u << 20;
+
+void adviseHugePages(const void* data, size_t bytes)
+{
+#ifdef __linux__
+	// madvise wants page-aligned ranges, the partial pages at either end keep their small pages
+	const uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + hugePageSize - 1) & ~(hugePageSize - 1);
+	const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(hugePageSize - 1);
+	if (end > begin)
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#else
+	(void)data;
+	(void)bytes;
+#endif
+}
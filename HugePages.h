@@ -0,0 +1,7 @@
+#pragma once
+#include <cstddef>
+
+// Asks for the whole 2 MB pages inside [data, data + bytes) to be backed by huge pages, so a pass
+// over a large array takes one TLB miss per 2 MB instead of one per 4 KB. Best given before the
+// memory is first touched. Only Linux takes the hint, elsewhere this does nothing.
+void adviseHugePages(const void* data, size_t bytes);
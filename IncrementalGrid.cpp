@@ -0,0 +1,207 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "IncrementalGrid.h"
+#include <vector>
+#include <algorithm>
+
+// Smallest region holds this many fish, each size class doubles it
+static const int minRegionSize = 8;
+
+static int regionSize(int sizeClass)
+{
+	return minRegionSize << sizeClass;
+}
+
+void IncrementalGrid::reset(const GridLayout& layout)
+{
+	m_layout = layout;
+	m_cells.assign(layout.cellCount(), Cell{});
+	m_slots.clear();
+	m_freeRegions.clear();
+	m_fishCell.clear();
+	m_fishSlot.clear();
+}
+
+int IncrementalGrid::allocateRegion(int sizeClass)
+{
+	// The first slot of a free region holds the offset of the next free region of its size class
+	if (sizeClass < static_cast<int>(m_freeRegions.size()) && m_freeRegions[sizeClass] >= 0)
+	{
+		int offset = m_freeRegions[sizeClass];
+		m_freeRegions[sizeClass] = m_slots[offset];
+		return offset;
+	}
+	// Out of room, squeeze out the recycled regions rather than growing the array
+	if (m_slots.size() + regionSize(sizeClass) > m_slots.capacity())
+		repack();
+	int offset = static_cast<int>(m_slots.size());
+	m_slots.resize(m_slots.size() + regionSize(sizeClass));
+	return offset;
+}
+
+void IncrementalGrid::repack()
+{
+	// Every occupied cell gets the smallest region that holds it, the free lists go with the old array
+	m_spareSlots.clear();
+	for (Cell& cell : m_cells)
+	{
+		if (cell.count == 0)
+		{
+			cell = Cell{};
+			continue;
+		}
+		int sizeClass = 0;
+		while (regionSize(sizeClass) < cell.count)
+			sizeClass++;
+		const int offset = static_cast<int>(m_spareSlots.size());
+		m_spareSlots.insert(m_spareSlots.end(), m_slots.begin() + cell.offset, m_slots.begin() + cell.offset + cell.count);
+		m_spareSlots.resize(offset + regionSize(sizeClass));
+		cell.offset = offset;
+		cell.sizeClass = sizeClass;
+	}
+	m_slots.swap(m_spareSlots);
+	std::fill(m_freeRegions.begin(), m_freeRegions.end(), -1);
+}
+
+void IncrementalGrid::insert(int fishIndex, int cellIndex)
+{
+	Cell& cell = m_cells[cellIndex];
+	if (cell.sizeClass < 0 || cell.count == regionSize(cell.sizeClass))
+	{
+		// Move the cell into a region twice the size and recycle the old one
+		int sizeClass = cell.sizeClass + 1;
+		int offset = allocateRegion(sizeClass);
+		std::copy(m_slots.begin() + cell.offset, m_slots.begin() + cell.offset + cell.count, m_slots.begin() + offset);
+		if (cell.sizeClass >= 0)
+		{
+			if (static_cast<int>(m_freeRegions.size()) <= cell.sizeClass)
+				m_freeRegions.resize(cell.sizeClass + 1, -1);
+			m_slots[cell.offset] = m_freeRegions[cell.sizeClass];
+			m_freeRegions[cell.sizeClass] = cell.offset;
+		}
+		cell.offset = offset;
+		cell.sizeClass = sizeClass;
+	}
+	m_slots[cell.offset + cell.count] = fishIndex;
+	m_fishCell[fishIndex] = cellIndex;
+	m_fishSlot[fishIndex] = cell.count;
+	cell.count++;
+}
+
+void IncrementalGrid::remove(int fishIndex)
+{
+	Cell& cell = m_cells[m_fishCell[fishIndex]];
+	int slot = m_fishSlot[fishIndex];
+	int last = m_slots[cell.offset + cell.count - 1];
+	m_slots[cell.offset + slot] = last;
+	m_fishSlot[last] = slot;
+	cell.count--;
+}
+
+void IncrementalGrid::reserve(int fishCount)
+{
+	m_fishCell.reserve(fishCount);
+	m_fishSlot.reserve(fishCount);
+	m_moves.reserve(fishCount);
+}
+
+void IncrementalGrid::build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize)
+{
+	const int fishCount = static_cast<int>(fishes.size());
+	const int trackedCount = static_cast<int>(m_fishCell.size());
+	const GridLayout layout = GridLayout::fit(raylibConfig, minCellSize);
+
+	// A new layout or a shrunk school invalidates the cell assignment, start over
+	if (layout != m_layout || fishCount < trackedCount)
+		reset(layout);
+
+	// Packed tightly the regions take under 2 slots per fish plus a smallest region per cell. Twice that
+	// holds a packed grid and the region a full cell moves to, so a school of steady size never grows it.
+	const size_t slotCapacity = 2 * (2 * static_cast<size_t>(fishCount) + minRegionSize * m_cells.size());
+	m_slots.reserve(slotCapacity);
+	m_spareSlots.reserve(slotCapacity);
+
+	// Find the movers in one streaming pass first, the cell edits that follow are independent
+	// of each other so their cache misses overlap instead of stalling the scan
+	m_moves.clear();
+	for (int i = 0; i < static_cast<int>(m_fishCell.size()); i++)
+	{
+		int cell = m_layout.cellOf(fishes[i].getPosition());
+		if (cell != m_fishCell[i])
+			m_moves.push_back({ i, cell });
+	}
+	for (const std::pair<int, int>& move : m_moves)
+		remove(move.first);
+	for (const std::pair<int, int>& move : m_moves)
+		insert(move.first, move.second);
+	m_movedCount = static_cast<int>(m_moves.size());
+
+	// Newly spawned fish are appended
+	const int oldCount = static_cast<int>(m_fishCell.size());
+	m_fishCell.resize(fishCount);
+	m_fishSlot.resize(fishCount);
+	for (int i = oldCount; i < fishCount; i++)
+	{
+		insert(i, m_layout.cellOf(fishes[i].getPosition()));
+		m_movedCount++;
+	}
+}
+
+void IncrementalGrid::query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const
+{
+	// Every cell the query box touches, the 27 around the fish while the radius is within a cell
+	const float radiusSqr = radius * radius;
+	const int minX = m_layout.coordX(position.x - radius);
+	const int minY = m_layout.coordY(position.y - radius);
+	const int minZ = m_layout.coordZ(position.z - radius);
+	const int maxX = m_layout.coordX(position.x + radius);
+	const int maxY = m_layout.coordY(position.y + radius);
+	const int maxZ = m_layout.coordZ(position.z + radius);
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				const Cell& cell = m_cells[m_layout.cellIndex(x, y, z)];
+				for (int s = cell.offset; s < cell.offset + cell.count; s++)
+				{
+					int other = m_slots[s];
+					if (Vector3DistanceSqr(position, fishes[other].getPosition()) < radiusSqr)
+						result.push_back(other);
+				}
+			}
+		}
+	}
+}
+
+void IncrementalGrid::swapRemove(int fishIndex, int fishCount)
+{
+	// Mirrors the school dropping a fish by moving its last fish into the gap
+	const int trackedCount = static_cast<int>(m_fishCell.size());
+	if (fishIndex >= trackedCount)
+		return;
+	if (fishCount != trackedCount)
+	{
+		// An untracked fish would move into the gap, start over on the next build
+		m_layout = GridLayout{};
+		return;
+	}
+
+	remove(fishIndex);
+	const int last = trackedCount - 1;
+	if (fishIndex != last)
+	{
+		m_slots[m_cells[m_fishCell[last]].offset + m_fishSlot[last]] = fishIndex;
+		m_fishCell[fishIndex] = m_fishCell[last];
+		m_fishSlot[fishIndex] = m_fishSlot[last];
+	}
+	m_fishCell.pop_back();
+	m_fishSlot.pop_back();
+}
+
+int IncrementalGrid::getMovedCount() const
+{
+	return m_movedCount;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+#include <utility>
+
+// Uniform grid kept up to date between steps instead of rebuilt.
+// Every cell owns a compact region of a shared slot array; a fish is only touched when it changes cell,
+// leaving its old cell by swapping in the cell's last entry. Regions come in power-of-two size classes and
+// a region outgrown by its cell goes on a free list for the next cell that needs that size. Free lists are
+// threaded through the free regions themselves, so recycling a region never allocates. A full slot array
+// is repacked into a spare one of the same capacity, fitting every cell tightly, instead of growing.
+class IncrementalGrid : public SpatialIndex
+{
+private:
+	struct Cell {
+		int offset{};
+		int count{};
+		int sizeClass{ -1 };
+	};
+
+	GridLayout m_layout;
+	std::vector<Cell> m_cells;
+	std::vector<int> m_slots;
+	std::vector<int> m_spareSlots;
+	std::vector<int> m_freeRegions;
+	std::vector<int> m_fishCell;
+	std::vector<int> m_fishSlot;
+	std::vector<std::pair<int, int>> m_moves;
+	int m_movedCount{};
+
+	void reset(const GridLayout& layout);
+	void insert(int fishIndex, int cell);
+	void remove(int fishIndex);
+	int allocateRegion(int sizeClass);
+	void repack();
+
+public:
+	void reserve(int fishCount);
+	void build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize) override;
+	void query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const override;
+	void swapRemove(int fishIndex, int fishCount);
+	int getMovedCount() const;
+};
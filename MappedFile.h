@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Data is paged in on first touch, so opening a large
+// file costs nothing up front and its contents can be used in place without parsing.
+class MappedFile
+{
+private:
+	const unsigned char* m_data{};
+	size_t m_size{};
+#ifdef _WIN32
+	void* m_file{};
+	void* m_mapping{};
+#else
+	int m_descriptor{ -1 };
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+	bool open(const char* path);
+	void close();
+	const unsigned char* data() const;
+	size_t size() const;
+};
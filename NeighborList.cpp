@@ -0,0 +1,179 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "NeighborList.h"
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+bool NeighborList::needsRebuild(const std::vector<Fish>& fishes, float cutoff, float skin) const
+{
+	if (fishes.size() != m_buildPositions.size() || cutoff != m_cutoff || skin != m_skin)
+		return true;
+
+	// Two fish closing in on each other can each cover half the skin before a pair is missed
+	const float halfSkin = skin * 0.5f;
+	const float halfSkinSqr = halfSkin * halfSkin;
+	for (size_t i = 0; i < fishes.size(); i++)
+	{
+		if (Vector3DistanceSqr(fishes[i].getPosition(), m_buildPositions[i]) > halfSkinSqr)
+			return true;
+	}
+	return false;
+}
+
+void NeighborList::reserve(int fishCount)
+{
+	m_offsets.reserve(fishCount + 1);
+	m_buildPositions.reserve(fishCount);
+	m_fishRows.reserve(fishCount);
+	m_rowFishes.reserve(fishCount);
+	m_remappedOffsets.reserve(fishCount + 1);
+	m_remappedPositions.reserve(fishCount);
+}
+
+void NeighborList::build(const std::vector<Fish>& fishes, SpatialIndex& spatialIndex, const RaylibConfig& raylibConfig, float cutoff, float skin)
+{
+	m_cutoff = cutoff;
+	m_skin = skin;
+	const float listRadius = cutoff + skin;
+	spatialIndex.build(fishes, raylibConfig, listRadius);
+
+	// Image (x, y, z) in -1..1 is stored as (x + 1) * 9 + (y + 1) * 3 + z + 1, 13 is the container itself
+	const Vector3 container{ raylibConfig.containerWidth, raylibConfig.containerHeight, raylibConfig.containerDepth };
+	for (int image = 0; image < 27; image++)
+		m_imageShifts[image] = Vector3{ (image / 9 - 1) * container.x, (image / 3 % 3 - 1) * container.y, (image % 3 - 1) * container.z };
+	const bool periodic = raylibConfig.boundary == Boundary::Periodic;
+	const Vector3 half = Vector3Scale(container, 0.5f);
+
+	// Ghost searches only hold while the list radius is under half of every side. Past that a fish
+	// could be found directly and through an image, or be near both walls of an axis. Every pair is
+	// then tested at its minimum image instead, which costs little more since most of the school is
+	// within reach of every fish anyway.
+	const bool minimumImage = periodic && listRadius * 2.0f > std::min({ container.x, container.y, container.z });
+	const float listRadiusSqr = listRadius * listRadius;
+
+	const int fishCount = static_cast<int>(fishes.size());
+	m_offsets.resize(fishCount + 1);
+	m_buildPositions.resize(fishCount);
+	m_neighbors.clear();
+	m_images.clear();
+	for (int i = 0; i < fishCount; i++)
+	{
+		m_offsets[i] = static_cast<int>(m_neighbors.size());
+		const Vector3 position = fishes[i].getPosition();
+		m_buildPositions[i] = position;
+		if (minimumImage)
+		{
+			for (int j = 0; j < fishCount; j++)
+			{
+				const Vector3 offset = Vector3Subtract(fishes[j].getPosition(), position);
+				const int x = offset.x > half.x ? -1 : (offset.x < -half.x ? 1 : 0);
+				const int y = offset.y > half.y ? -1 : (offset.y < -half.y ? 1 : 0);
+				const int z = offset.z > half.z ? -1 : (offset.z < -half.z ? 1 : 0);
+				const int image = (x + 1) * 9 + (y + 1) * 3 + z + 1;
+				if (Vector3LengthSqr(Vector3Add(offset, m_imageShifts[image])) >= listRadiusSqr)
+					continue;
+				m_neighbors.push_back(j);
+				m_images.push_back(static_cast<unsigned char>(image));
+			}
+			continue;
+		}
+		spatialIndex.query(position, listRadius, fishes, m_neighbors);
+		m_images.resize(m_neighbors.size(), 13);
+		if (!periodic)
+			continue;
+
+		// Near a face, also search from the fish's ghost across it. A fish found around the ghost
+		// position + shift is a neighbor at its own position - shift.
+		const int stepX = position.x < -half.x + listRadius ? 1 : (position.x > half.x - listRadius ? -1 : 0);
+		const int stepY = position.y < -half.y + listRadius ? 1 : (position.y > half.y - listRadius ? -1 : 0);
+		const int stepZ = position.z < -half.z + listRadius ? 1 : (position.z > half.z - listRadius ? -1 : 0);
+		for (int image = 0; image < 27; image++)
+		{
+			const int x = image / 9 - 1;
+			const int y = image / 3 % 3 - 1;
+			const int z = image % 3 - 1;
+			if (image == 13 || (x != 0 && x != stepX) || (y != 0 && y != stepY) || (z != 0 && z != stepZ))
+				continue;
+			spatialIndex.query(Vector3Add(position, m_imageShifts[image]), listRadius, fishes, m_neighbors);
+			m_images.resize(m_neighbors.size(), static_cast<unsigned char>(26 - image));
+		}
+	}
+	m_offsets[fishCount] = static_cast<int>(m_neighbors.size());
+	m_fishRows.resize(fishCount);
+	std::iota(m_fishRows.begin(), m_fishRows.end(), 0);
+	m_removalsPending = false;
+}
+
+bool NeighborList::swapRemove(int fishIndex, int fishCount)
+{
+	// Mirrors the school dropping a fish by moving its last fish into the gap.
+	// Fails if the list does not hold exactly these fish, it has to be rebuilt then.
+	if (fishCount != static_cast<int>(m_fishRows.size()))
+		return false;
+	m_fishRows[fishIndex] = m_fishRows[fishCount - 1];
+	m_fishRows.pop_back();
+	m_removalsPending = true;
+	return true;
+}
+
+void NeighborList::applyRemovals()
+{
+	if (!m_removalsPending)
+		return;
+	m_removalsPending = false;
+
+	// Rows of removed fish map to -1, every other row to its fish's new index
+	const int rowCount = static_cast<int>(m_buildPositions.size());
+	const int fishCount = static_cast<int>(m_fishRows.size());
+	m_rowFishes.assign(rowCount, -1);
+	for (int i = 0; i < fishCount; i++)
+		m_rowFishes[m_fishRows[i]] = i;
+
+	// Copy each remaining row to its fish's place, dropping removed neighbors and renaming moved ones
+	m_remappedOffsets.resize(fishCount + 1);
+	m_remappedPositions.resize(fishCount);
+	m_remappedNeighbors.clear();
+	m_remappedImages.clear();
+	for (int i = 0; i < fishCount; i++)
+	{
+		const int row = m_fishRows[i];
+		m_remappedOffsets[i] = static_cast<int>(m_remappedNeighbors.size());
+		m_remappedPositions[i] = m_buildPositions[row];
+		for (int n = m_offsets[row]; n < m_offsets[row + 1]; n++)
+		{
+			const int neighbor = m_rowFishes[m_neighbors[n]];
+			if (neighbor < 0) continue;
+			m_remappedNeighbors.push_back(neighbor);
+			m_remappedImages.push_back(m_images[n]);
+		}
+	}
+	m_remappedOffsets[fishCount] = static_cast<int>(m_remappedNeighbors.size());
+
+	std::swap(m_offsets, m_remappedOffsets);
+	std::swap(m_neighbors, m_remappedNeighbors);
+	std::swap(m_images, m_remappedImages);
+	std::swap(m_buildPositions, m_remappedPositions);
+	std::iota(m_fishRows.begin(), m_fishRows.end(), 0);
+}
+
+const int* NeighborList::neighbors(int index) const
+{
+	return m_neighbors.data() + m_offsets[index];
+}
+
+const unsigned char* NeighborList::images(int index) const
+{
+	return m_images.data() + m_offsets[index];
+}
+
+const Vector3* NeighborList::imageShifts() const
+{
+	return m_imageShifts;
+}
+
+int NeighborList::neighborCount(int index) const
+{
+	return m_offsets[index + 1] - m_offsets[index];
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+
+// Verlet neighbor list: every fish keeps the fish within cutoff + skin of it.
+// The list stays valid until some fish has moved more than half the skin since the last build,
+// so the grid is only traversed every few steps while the school is settled.
+// With the periodic boundary each entry also records the image of the container its fish is seen
+// through, so the gather loop adds a shift from a 27-entry table instead of wrapping every pair.
+// Images are found by searching from ghost positions across the nearby faces, which needs the list
+// radius under half of every container side; smaller containers fall back to the minimum image per pair.
+// Removing a fish only records which row each fish now reads; the rows are remapped in one pass before the next step.
+class NeighborList
+{
+private:
+	float m_cutoff{};
+	float m_skin{};
+	std::vector<int> m_offsets;
+	std::vector<int> m_neighbors;
+	std::vector<unsigned char> m_images;
+	Vector3 m_imageShifts[27]{};
+	std::vector<Vector3> m_buildPositions;
+	std::vector<int> m_fishRows;
+	std::vector<int> m_rowFishes;
+	std::vector<int> m_remappedOffsets;
+	std::vector<int> m_remappedNeighbors;
+	std::vector<unsigned char> m_remappedImages;
+	std::vector<Vector3> m_remappedPositions;
+	bool m_removalsPending{};
+
+public:
+	void reserve(int fishCount);
+	bool needsRebuild(const std::vector<Fish>& fishes, float cutoff, float skin) const;
+	void build(const std::vector<Fish>& fishes, SpatialIndex& spatialIndex, const RaylibConfig& raylibConfig, float cutoff, float skin);
+	bool swapRemove(int fishIndex, int fishCount);
+	void applyRemovals();
+	const int* neighbors(int index) const;
+	const unsigned char* images(int index) const;
+	const Vector3* imageShifts() const;
+	int neighborCount(int index) const;
+};
@@ -0,0 +1,285 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "ObstacleBVH.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+static const int leafSize = 2;
+
+// Entry and exit distance of a ray through a box, inverse direction precomputed
+static bool slab(Vector3 origin, Vector3 inverseDirection, Vector3 min, Vector3 max, float& enter, float& exit)
+{
+	float tx0 = (min.x - origin.x) * inverseDirection.x;
+	float tx1 = (max.x - origin.x) * inverseDirection.x;
+	float ty0 = (min.y - origin.y) * inverseDirection.y;
+	float ty1 = (max.y - origin.y) * inverseDirection.y;
+	float tz0 = (min.z - origin.z) * inverseDirection.z;
+	float tz1 = (max.z - origin.z) * inverseDirection.z;
+	enter = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1) });
+	exit = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1) });
+	return enter <= exit && exit >= 0.0f;
+}
+
+const ObstacleConfig& ObstacleBVH::getConfig() const
+{
+	return m_config;
+}
+
+void ObstacleBVH::setConfig(const ObstacleConfig& config)
+{
+	m_config = config;
+}
+
+int ObstacleBVH::addSphere(Vector3 center, float radius)
+{
+	m_obstacles.push_back(Obstacle{ center, Vector3{ radius, radius, radius }, radius, true });
+	m_needsBuild = true;
+	return static_cast<int>(m_obstacles.size()) - 1;
+}
+
+int ObstacleBVH::addBox(Vector3 center, Vector3 size)
+{
+	m_obstacles.push_back(Obstacle{ center, Vector3Scale(size, 0.5f), 0.0f, false });
+	m_needsBuild = true;
+	return static_cast<int>(m_obstacles.size()) - 1;
+}
+
+void ObstacleBVH::setPosition(int obstacle, Vector3 center)
+{
+	m_obstacles[obstacle].center = center;
+	m_needsRefit = true;
+}
+
+Vector3 ObstacleBVH::getPosition(int obstacle) const
+{
+	return m_obstacles[obstacle].center;
+}
+
+bool ObstacleBVH::empty() const
+{
+	return m_obstacles.empty();
+}
+
+BoundingBox ObstacleBVH::getBounds() const
+{
+	// The root box as of the last update
+	if (m_nodes.empty())
+		return BoundingBox{};
+	return BoundingBox{ m_nodes[0].min, m_nodes[0].max };
+}
+
+void ObstacleBVH::clear()
+{
+	m_obstacles.clear();
+	m_order.clear();
+	m_nodes.clear();
+	m_needsBuild = false;
+	m_needsRefit = false;
+}
+
+void ObstacleBVH::bounds(const Obstacle& obstacle, Vector3& min, Vector3& max) const
+{
+	min = Vector3Subtract(obstacle.center, obstacle.halfSize);
+	max = Vector3Add(obstacle.center, obstacle.halfSize);
+}
+
+int ObstacleBVH::build(int first, int count)
+{
+	const int nodeIndex = static_cast<int>(m_nodes.size());
+	m_nodes.push_back(Node{});
+	Vector3 min{};
+	Vector3 max{};
+	bounds(m_obstacles[m_order[first]], min, max);
+	for (int i = first; i < first + count; i++)
+	{
+		Vector3 lo{};
+		Vector3 hi{};
+		bounds(m_obstacles[m_order[i]], lo, hi);
+		min = Vector3Min(min, lo);
+		max = Vector3Max(max, hi);
+	}
+	m_nodes[nodeIndex].min = min;
+	m_nodes[nodeIndex].max = max;
+
+	if (count <= leafSize)
+	{
+		m_nodes[nodeIndex].first = first;
+		m_nodes[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	// Median split of the centres along the longest axis
+	Vector3 extent = Vector3Subtract(max, min);
+	int axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+	const int half = count / 2;
+	std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+		[this, axis](int a, int b) {
+			const Vector3& ca = m_obstacles[a].center;
+			const Vector3& cb = m_obstacles[b].center;
+			return axis == 0 ? ca.x < cb.x : (axis == 1 ? ca.y < cb.y : ca.z < cb.z);
+		});
+	int left = build(first, half);
+	int right = build(first + half, count - half);
+	m_nodes[nodeIndex].left = left;
+	m_nodes[nodeIndex].right = right;
+	return nodeIndex;
+}
+
+void ObstacleBVH::refit()
+{
+	// Children are always created after their parent, so a reverse sweep sees them first
+	for (int n = static_cast<int>(m_nodes.size()) - 1; n >= 0; n--)
+	{
+		Node& node = m_nodes[n];
+		if (node.left < 0)
+		{
+			bounds(m_obstacles[m_order[node.first]], node.min, node.max);
+			for (int i = node.first + 1; i < node.first + node.count; i++)
+			{
+				Vector3 lo{};
+				Vector3 hi{};
+				bounds(m_obstacles[m_order[i]], lo, hi);
+				node.min = Vector3Min(node.min, lo);
+				node.max = Vector3Max(node.max, hi);
+			}
+			continue;
+		}
+		node.min = Vector3Min(m_nodes[node.left].min, m_nodes[node.right].min);
+		node.max = Vector3Max(m_nodes[node.left].max, m_nodes[node.right].max);
+	}
+}
+
+void ObstacleBVH::update()
+{
+	if (m_needsBuild)
+	{
+		m_nodes.clear();
+		m_order.resize(m_obstacles.size());
+		for (size_t i = 0; i < m_order.size(); i++)
+			m_order[i] = static_cast<int>(i);
+		if (!m_obstacles.empty())
+			build(0, static_cast<int>(m_obstacles.size()));
+	}
+	else if (m_needsRefit)
+		refit();
+	m_needsBuild = false;
+	m_needsRefit = false;
+}
+
+bool ObstacleBVH::castObstacle(const Obstacle& obstacle, Ray ray, float radius, float maxDistance, RayHit& hit) const
+{
+	if (obstacle.sphere)
+	{
+		// Ray against the sphere grown by the cast radius
+		const float grown = obstacle.radius + radius;
+		Vector3 offset = Vector3Subtract(ray.position, obstacle.center);
+		float b = Vector3DotProduct(offset, ray.direction);
+		float c = Vector3LengthSqr(offset) - grown * grown;
+		if (c <= 0.0f)
+		{
+			hit.distance = 0.0f;
+			hit.normal = Vector3Normalize(offset);
+			return true;
+		}
+		float discriminant = b * b - c;
+		if (b > 0.0f || discriminant < 0.0f)
+			return false;
+		float t = -b - std::sqrt(discriminant);
+		if (t >= maxDistance)
+			return false;
+		hit.distance = t;
+		hit.normal = Vector3Normalize(Vector3Add(offset, Vector3Scale(ray.direction, t)));
+		return true;
+	}
+
+	// Ray against the box grown by the cast radius, normal from the slab it enters through
+	Vector3 grownHalf = Vector3AddValue(obstacle.halfSize, radius);
+	Vector3 min = Vector3Subtract(obstacle.center, grownHalf);
+	Vector3 max = Vector3Add(obstacle.center, grownHalf);
+	Vector3 inverse{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+	float enter = 0.0f;
+	float exit = 0.0f;
+	if (!slab(ray.position, inverse, min, max, enter, exit) || enter >= maxDistance)
+		return false;
+
+	Vector3 point = Vector3Add(ray.position, Vector3Scale(ray.direction, std::max(enter, 0.0f)));
+	Vector3 local = Vector3Subtract(point, obstacle.center);
+	Vector3 depth{ std::fabs(local.x) / grownHalf.x, std::fabs(local.y) / grownHalf.y, std::fabs(local.z) / grownHalf.z };
+	hit.normal = Vector3Zero();
+	if (depth.x >= depth.y && depth.x >= depth.z) hit.normal.x = local.x < 0.0f ? -1.0f : 1.0f;
+	else if (depth.y >= depth.z) hit.normal.y = local.y < 0.0f ? -1.0f : 1.0f;
+	else hit.normal.z = local.z < 0.0f ? -1.0f : 1.0f;
+	hit.distance = std::max(enter, 0.0f);
+	return true;
+}
+
+RayHit ObstacleBVH::cast(Ray ray, float radius) const
+{
+	RayHit best;
+	best.distance = m_config.avoidDistance;
+	if (m_nodes.empty())
+		return best;
+
+	const Vector3 inverse{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		float enter = 0.0f;
+		float exit = 0.0f;
+		if (!slab(ray.position, inverse, Vector3SubtractValue(node.min, radius), Vector3AddValue(node.max, radius), enter, exit) || enter >= best.distance)
+			continue;
+
+		if (node.left >= 0)
+		{
+			stack[stackSize++] = node.left;
+			stack[stackSize++] = node.right;
+			continue;
+		}
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			RayHit hit;
+			if (castObstacle(m_obstacles[m_order[i]], ray, radius, best.distance, hit))
+			{
+				best = hit;
+				best.obstacle = m_order[i];
+			}
+		}
+	}
+	return best;
+}
+
+void ObstacleBVH::castRange(const Ray* rays, float radius, RayHit* hits, int begin, int end) const
+{
+	for (int i = begin; i < end; i++)
+		hits[i] = cast(rays[i], radius);
+}
+
+void ObstacleBVH::sphereCast(const Ray* rays, int rayCount, float radius, RayHit* hits, WorkerPool& pool, int workerCount) const
+{
+	workerCount = std::clamp(workerCount, 1, std::max(rayCount, 1));
+	if (workerCount == 1)
+	{
+		castRange(rays, radius, hits, 0, rayCount);
+		return;
+	}
+
+	// Contiguous chunks, the calling thread takes the last one
+	const int chunk = (rayCount + workerCount - 1) / workerCount;
+	auto castChunk = [&](int w) { castRange(rays, radius, hits, std::min(w * chunk, rayCount), std::min((w + 1) * chunk, rayCount)); };
+	pool.run(workerCount, castChunk);
+}
+
+Vector3 ObstacleBVH::avoid(const RayHit& hit) const
+{
+	if (hit.obstacle < 0)
+		return Vector3Zero();
+
+	// Turn away along the surface normal, harder the sooner the hit
+	float strength = m_config.avoidFactor * (1.0f - hit.distance / m_config.avoidDistance);
+	return Vector3Scale(hit.normal, strength);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "raylib.h"
+#include "SignedDistanceField.h"
+#include "WorkerPool.h"
+#include <vector>
+
+struct RayHit {
+	float distance{};
+	Vector3 normal{};
+	int obstacle{ -1 };
+};
+
+// Bounding volume hierarchy over moving obstacles (boats, nets) that would be too costly to rebake
+// into the distance field every frame. The tree is built once per obstacle set; moving obstacles
+// only refits the node bounds bottom-up. Fish look ahead along their velocity with sphere casts
+// that are answered for the whole flock in one batch, split across worker threads.
+class ObstacleBVH
+{
+private:
+	struct Obstacle {
+		Vector3 center{};
+		Vector3 halfSize{};
+		float radius{};
+		bool sphere{};
+	};
+	struct Node {
+		Vector3 min{};
+		Vector3 max{};
+		int left{ -1 };
+		int right{ -1 };
+		int first{};
+		int count{};
+	};
+
+	ObstacleConfig m_config{};
+	std::vector<Obstacle> m_obstacles;
+	std::vector<int> m_order;
+	std::vector<Node> m_nodes;
+	bool m_needsBuild{};
+	bool m_needsRefit{};
+
+	void bounds(const Obstacle& obstacle, Vector3& min, Vector3& max) const;
+	int build(int first, int count);
+	void refit();
+	bool castObstacle(const Obstacle& obstacle, Ray ray, float radius, float maxDistance, RayHit& hit) const;
+	RayHit cast(Ray ray, float radius) const;
+	void castRange(const Ray* rays, float radius, RayHit* hits, int begin, int end) const;
+
+public:
+	const ObstacleConfig& getConfig() const;
+	void setConfig(const ObstacleConfig& config);
+	int addSphere(Vector3 center, float radius);
+	int addBox(Vector3 center, Vector3 size);
+	void setPosition(int obstacle, Vector3 center);
+	Vector3 getPosition(int obstacle) const;
+	bool empty() const;
+	BoundingBox getBounds() const;
+	void clear();
+	void update();
+	void sphereCast(const Ray* rays, int rayCount, float radius, RayHit* hits, WorkerPool& pool, int workerCount) const;
+	Vector3 avoid(const RayHit& hit) const;
+};
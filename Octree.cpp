@@ -0,0 +1,251 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Octree.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Fish spawned on the same spot cannot be separated, stop splitting at this depth
+static const int maxDepth = 16;
+
+enum Rule {
+	SeperationRule = 1 << 0,
+	AlignmentRule = 1 << 1,
+	CohesionRule = 1 << 2,
+};
+
+Octree::Octree(float theta, int leafSize) : m_theta{ theta }, m_leafSize{ leafSize } {};
+
+void Octree::build(const std::vector<Fish>& fishes)
+{
+	const int fishCount = static_cast<int>(fishes.size());
+	m_nodes.clear();
+	m_indices.resize(fishCount);
+	m_slot.resize(fishCount);
+	m_scratch.resize(fishCount);
+	m_sorted.resize(fishCount);
+	if (fishCount == 0)
+		return;
+
+	// Root cube around the fish rather than the container, fish overshoot the walls while turning
+	Vector3 lo = fishes[0].getPosition();
+	Vector3 hi = lo;
+	for (int i = 0; i < fishCount; i++)
+	{
+		lo = Vector3Min(lo, fishes[i].getPosition());
+		hi = Vector3Max(hi, fishes[i].getPosition());
+		m_indices[i] = i;
+	}
+	Node root;
+	root.center = Vector3Scale(Vector3Add(lo, hi), 0.5f);
+	root.halfSize = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z }) * 0.5f + 1e-3f;
+	root.begin = 0;
+	root.end = fishCount;
+	m_nodes.push_back(root);
+	split(0, fishes, 0);
+
+	for (int s = 0; s < fishCount; s++)
+		m_slot[m_indices[s]] = s;
+}
+
+void Octree::build(const std::vector<Fish>& fishes, const RaylibConfig&, float)
+{
+	build(fishes);
+}
+
+void Octree::split(int nodeIndex, const std::vector<Fish>& fishes, int depth)
+{
+	Node node = m_nodes[nodeIndex];
+	for (int s = node.begin; s < node.end; s++)
+	{
+		const Fish& fish = fishes[m_indices[s]];
+		node.positionSum = Vector3Add(node.positionSum, fish.getPosition());
+		node.velocitySum = Vector3Add(node.velocitySum, fish.getVelocity());
+	}
+	node.count = node.end - node.begin;
+
+	if (node.count <= m_leafSize || depth >= maxDepth)
+	{
+		m_nodes[nodeIndex] = node;
+		return;
+	}
+
+	// Partition the node's slice of m_indices by octant with a counting sort
+	int octantStart[9]{};
+	for (int s = node.begin; s < node.end; s++)
+	{
+		Vector3 pos = fishes[m_indices[s]].getPosition();
+		int octant = (pos.x >= node.center.x) | (pos.y >= node.center.y) << 1 | (pos.z >= node.center.z) << 2;
+		m_scratch[s] = octant;
+		octantStart[octant + 1]++;
+	}
+	for (int o = 0; o < 8; o++)
+		octantStart[o + 1] += octantStart[o];
+
+	int cursor[8];
+	for (int o = 0; o < 8; o++)
+		cursor[o] = node.begin + octantStart[o];
+	for (int s = node.begin; s < node.end; s++)
+		m_sorted[cursor[m_scratch[s]]++] = m_indices[s];
+	std::copy(m_sorted.begin() + node.begin, m_sorted.begin() + node.end, m_indices.begin() + node.begin);
+
+	node.firstChild = static_cast<int>(m_nodes.size());
+	m_nodes[nodeIndex] = node;
+	const float childHalf = node.halfSize * 0.5f;
+	for (int o = 0; o < 8; o++)
+	{
+		Node child;
+		child.center = Vector3{
+			node.center.x + ((o & 1) ? childHalf : -childHalf),
+			node.center.y + ((o & 2) ? childHalf : -childHalf),
+			node.center.z + ((o & 4) ? childHalf : -childHalf)
+		};
+		child.halfSize = childHalf;
+		child.begin = node.begin + octantStart[o];
+		child.end = node.begin + octantStart[o + 1];
+		m_nodes.push_back(child);
+	}
+	for (int o = 0; o < 8; o++)
+		split(node.firstChild + o, fishes, depth + 1);
+}
+
+NeighborSums Octree::query(int fishIndex, const std::vector<Fish>& fishes, const SimulationConfig& simConfig) const
+{
+	NeighborSums sums;
+	if (m_nodes.empty())
+		return sums;
+
+	const float radii[3]{ simConfig.seperationRadius, simConfig.alignmentRadius, simConfig.cohesionRadius };
+	gather(0, fishIndex, fishes, radii, SeperationRule | AlignmentRule | CohesionRule, sums);
+	return sums;
+}
+
+void Octree::query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const
+{
+	if (!m_nodes.empty())
+		collect(0, position, radius, fishes, result);
+}
+
+void Octree::collect(int nodeIndex, Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.count == 0)
+		return;
+
+	// Skip cubes the sphere misses, take cubes it contains whole, test leaves fish by fish
+	Vector3 offset = Vector3Subtract(position, node.center);
+	Vector3 absOffset{ std::fabs(offset.x), std::fabs(offset.y), std::fabs(offset.z) };
+	const float radiusSqr = radius * radius;
+	if (Vector3LengthSqr(Vector3Max(Vector3SubtractValue(absOffset, node.halfSize), Vector3Zero())) >= radiusSqr)
+		return;
+	if (Vector3LengthSqr(Vector3AddValue(absOffset, node.halfSize)) < radiusSqr)
+	{
+		result.insert(result.end(), m_indices.begin() + node.begin, m_indices.begin() + node.end);
+		return;
+	}
+	if (node.firstChild >= 0)
+	{
+		for (int o = 0; o < 8; o++)
+			collect(node.firstChild + o, position, radius, fishes, result);
+		return;
+	}
+	for (int s = node.begin; s < node.end; s++)
+	{
+		if (Vector3DistanceSqr(position, fishes[m_indices[s]].getPosition()) < radiusSqr)
+			result.push_back(m_indices[s]);
+	}
+}
+
+void Octree::gather(int nodeIndex, int fishIndex, const std::vector<Fish>& fishes, const float* radii, int pendingRules, NeighborSums& sums) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.count == 0)
+		return;
+
+	const Vector3 position = fishes[fishIndex].getPosition();
+	const bool containsSelf = m_slot[fishIndex] >= node.begin && m_slot[fishIndex] < node.end;
+
+	// Nearest and farthest distance from the fish to the node's cube
+	Vector3 offset = Vector3Subtract(position, node.center);
+	Vector3 absOffset{ std::fabs(offset.x), std::fabs(offset.y), std::fabs(offset.z) };
+	Vector3 outside = Vector3Max(Vector3SubtractValue(absOffset, node.halfSize), Vector3Zero());
+	const float nearSqr = Vector3LengthSqr(outside);
+	const float farSqr = Vector3LengthSqr(Vector3AddValue(absOffset, node.halfSize));
+	const float diagonal = node.halfSize * 2.0f * 1.7320508f;
+	const Vector3 centerOfMass = Vector3Scale(node.positionSum, 1.0f / node.count);
+
+	int openRules = 0;
+	for (int r = 0; r < 3; r++)
+	{
+		const int rule = 1 << r;
+		if (!(pendingRules & rule))
+			continue;
+
+		const float radiusSqr = radii[r] * radii[r];
+		if (nearSqr >= radiusSqr)
+			continue;
+		if (farSqr >= radiusSqr)
+		{
+			// Straddling the surface: open it while it is coarse compared to the radius,
+			// past that accept or reject it as a unit by its centre of mass
+			if (diagonal > m_theta * radii[r])
+			{
+				openRules |= rule;
+				continue;
+			}
+			if (Vector3DistanceSqr(position, centerOfMass) >= radiusSqr)
+				continue;
+		}
+
+		// The fish itself is part of the aggregate, take it back out
+		const int count = containsSelf ? node.count - 1 : node.count;
+		if (rule == SeperationRule)
+		{
+			sums.closeVel = Vector3Add(sums.closeVel, Vector3Subtract(Vector3Scale(position, static_cast<float>(node.count)), node.positionSum));
+		}
+		else if (rule == AlignmentRule)
+		{
+			Vector3 velocitySum = containsSelf ? Vector3Subtract(node.velocitySum, fishes[fishIndex].getVelocity()) : node.velocitySum;
+			sums.velocitySum = Vector3Add(sums.velocitySum, velocitySum);
+			sums.alignmentWeight += static_cast<float>(count);
+		}
+		else
+		{
+			Vector3 positionSum = containsSelf ? Vector3Subtract(node.positionSum, position) : node.positionSum;
+			sums.positionSum = Vector3Add(sums.positionSum, positionSum);
+			sums.cohesionWeight += static_cast<float>(count);
+		}
+	}
+
+	if (openRules == 0)
+		return;
+
+	if (node.firstChild >= 0)
+	{
+		for (int o = 0; o < 8; o++)
+			gather(node.firstChild + o, fishIndex, fishes, radii, openRules, sums);
+		return;
+	}
+
+	// Leaf straddling a sphere: test its fish exactly
+	for (int s = node.begin; s < node.end; s++)
+	{
+		const int other = m_indices[s];
+		if (other == fishIndex) continue;
+		Vector3 otherPosition = fishes[other].getPosition();
+		float distSqr = Vector3DistanceSqr(position, otherPosition);
+
+		if ((openRules & SeperationRule) && distSqr < radii[0] * radii[0])
+			sums.closeVel = Vector3Add(sums.closeVel, Vector3Subtract(position, otherPosition));
+		if ((openRules & AlignmentRule) && distSqr < radii[1] * radii[1])
+		{
+			sums.velocitySum = Vector3Add(sums.velocitySum, fishes[other].getVelocity());
+			sums.alignmentWeight += 1.0f;
+		}
+		if ((openRules & CohesionRule) && distSqr < radii[2] * radii[2])
+		{
+			sums.positionSum = Vector3Add(sums.positionSum, otherPosition);
+			sums.cohesionWeight += 1.0f;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+
+// Barnes-Hut style octree for large rule radii.
+// Every node stores the position sum, velocity sum and count of the fish below it, so a node lying
+// entirely inside a rule sphere contributes in O(1). A node straddling the sphere surface is only
+// opened while its diagonal is larger than theta * radius; past that it is counted whole or not at all
+// by its centre of mass, so only fish within theta * radius of the surface can be misclassified.
+// Radius queries are exact, the root cube fits the fish so the container and cell size do not apply.
+class Octree : public SpatialIndex
+{
+private:
+	struct Node {
+		Vector3 center{};
+		float halfSize{};
+		Vector3 positionSum{};
+		Vector3 velocitySum{};
+		int count{};
+		int begin{};
+		int end{};
+		int firstChild{ -1 };
+	};
+
+	float m_theta{};
+	int m_leafSize{};
+	std::vector<Node> m_nodes;
+	std::vector<int> m_indices;
+	std::vector<int> m_slot;
+	std::vector<int> m_scratch;
+	std::vector<int> m_sorted;
+
+	void split(int nodeIndex, const std::vector<Fish>& fishes, int depth);
+	void gather(int nodeIndex, int fishIndex, const std::vector<Fish>& fishes, const float* radii, int pendingRules, NeighborSums& sums) const;
+	void collect(int nodeIndex, Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const;
+
+public:
+	Octree(float theta, int leafSize);
+	void build(const std::vector<Fish>& fishes);
+	void build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize) override;
+	NeighborSums query(int fishIndex, const std::vector<Fish>& fishes, const SimulationConfig& simConfig) const;
+	void query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const override;
+};
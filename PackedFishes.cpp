@@ -0,0 +1,55 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "PackedFishes.h"
+#include "HugePages.h"
+#include <vector>
+#include <algorithm>
+
+// Fixed point covers the container and this much of its size again on every side
+static const float positionPadding = 0.25f;
+
+void PackedFishes::reserve(int fishCount)
+{
+	m_fishes.reserve(fishCount);
+	adviseHugePages(m_fishes.data(), m_fishes.capacity() * sizeof(PackedFish));
+}
+
+void PackedFishes::prepare(int fishCount, const RaylibConfig& raylibConfig, float maxSpeed)
+{
+	// Scales follow the container and the top speed, entries are left for store to fill
+	m_container = Vector3{ raylibConfig.containerWidth, raylibConfig.containerHeight, raylibConfig.containerDepth };
+	m_maxSpeed = maxSpeed;
+	const Vector3 range = Vector3Scale(m_container, 1.0f + 2.0f * positionPadding);
+	m_origin = Vector3Scale(range, -0.5f);
+	m_step = Vector3Scale(range, 1.0f / packedLevels);
+	m_inverseStep = Vector3{ packedLevels / range.x, packedLevels / range.y, packedLevels / range.z };
+	const float speedRange = 2.0f * std::max(maxSpeed, 1e-6f);
+	m_velocityStep = speedRange / packedLevels;
+	m_inverseVelocityStep = packedLevels / speedRange;
+	m_fishes.resize(fishCount);
+}
+
+bool PackedFishes::fits(const RaylibConfig& raylibConfig, float maxSpeed) const
+{
+	return m_container.x == raylibConfig.containerWidth && m_container.y == raylibConfig.containerHeight
+		&& m_container.z == raylibConfig.containerDepth && m_maxSpeed == maxSpeed;
+}
+
+void PackedFishes::pack(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float maxSpeed)
+{
+	prepare(static_cast<int>(fishes.size()), raylibConfig, maxSpeed);
+	for (size_t i = 0; i < fishes.size(); i++)
+		store(static_cast<int>(i), fishes[i].getPosition(), fishes[i].getVelocity(), fishes[i].getSpecies());
+}
+
+void PackedFishes::swapRemove(int index)
+{
+	// Mirrors the flock moving its last fish into the gap
+	m_fishes[index] = m_fishes.back();
+	m_fishes.pop_back();
+}
+
+int PackedFishes::size() const
+{
+	return static_cast<int>(m_fishes.size());
+}
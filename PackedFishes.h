@@ -0,0 +1,78 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// One fish in 14 bytes instead of 32: position and velocity as 16-bit fixed point and the species
+struct PackedFish {
+	uint16_t position[3];
+	uint16_t velocity[3];
+	uint16_t species;
+};
+
+static const float packedLevels = 65535.0f;
+
+// Reduced-precision copy of the flock for the neighbor loop to stream. Integration stores each fish as
+// it moves it, so keeping the copy current costs no pass of its own; it is packed in full only after
+// fish were added or wrapped or the container or top speed changed. Positions are fixed point over the
+// container grown by a quarter on every side, fish further out are clamped to its faces; in the 50 unit
+// viewer cube a step is 0.0011 units. Velocities are fixed point over the top speed of any species,
+// 0.0018 units/s at 60. Unpacking is a multiply-add per component inside the loop.
+// The mode only pays off once the neighbor loop waits on memory, when the full-precision fish (32 bytes
+// each) no longer fit in the last-level cache but the packed ones (14 bytes) still do. While they fit,
+// the decoding costs more than it saves: with a 300 MB cache, 5k to 200k fish stepped 8-24% slower.
+class PackedFishes
+{
+private:
+	std::vector<PackedFish> m_fishes;
+	Vector3 m_container{};
+	float m_maxSpeed{};
+	Vector3 m_origin{};
+	Vector3 m_step{};
+	Vector3 m_inverseStep{};
+	float m_velocityStep{};
+	float m_inverseVelocityStep{};
+
+public:
+	void reserve(int fishCount);
+	void prepare(int fishCount, const RaylibConfig& raylibConfig, float maxSpeed);
+	bool fits(const RaylibConfig& raylibConfig, float maxSpeed) const;
+	void pack(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float maxSpeed);
+	void store(int index, Vector3 position, Vector3 velocity, int species);
+	void swapRemove(int index);
+	int size() const;
+	Vector3 position(int index) const;
+	Vector3 velocity(int index) const;
+	int species(int index) const;
+};
+
+inline void PackedFishes::store(int index, Vector3 position, Vector3 velocity, int species)
+{
+	PackedFish& packed = m_fishes[index];
+	packed.position[0] = static_cast<uint16_t>(std::clamp((position.x - m_origin.x) * m_inverseStep.x + 0.5f, 0.0f, packedLevels));
+	packed.position[1] = static_cast<uint16_t>(std::clamp((position.y - m_origin.y) * m_inverseStep.y + 0.5f, 0.0f, packedLevels));
+	packed.position[2] = static_cast<uint16_t>(std::clamp((position.z - m_origin.z) * m_inverseStep.z + 0.5f, 0.0f, packedLevels));
+	packed.velocity[0] = static_cast<uint16_t>(std::clamp((velocity.x + m_maxSpeed) * m_inverseVelocityStep + 0.5f, 0.0f, packedLevels));
+	packed.velocity[1] = static_cast<uint16_t>(std::clamp((velocity.y + m_maxSpeed) * m_inverseVelocityStep + 0.5f, 0.0f, packedLevels));
+	packed.velocity[2] = static_cast<uint16_t>(std::clamp((velocity.z + m_maxSpeed) * m_inverseVelocityStep + 0.5f, 0.0f, packedLevels));
+	packed.species = static_cast<uint16_t>(species);
+}
+
+inline Vector3 PackedFishes::position(int index) const
+{
+	const PackedFish& fish = m_fishes[index];
+	return Vector3{ m_origin.x + fish.position[0] * m_step.x, m_origin.y + fish.position[1] * m_step.y, m_origin.z + fish.position[2] * m_step.z };
+}
+
+inline Vector3 PackedFishes::velocity(int index) const
+{
+	const PackedFish& fish = m_fishes[index];
+	return Vector3{ fish.velocity[0] * m_velocityStep - m_maxSpeed, fish.velocity[1] * m_velocityStep - m_maxSpeed, fish.velocity[2] * m_velocityStep - m_maxSpeed };
+}
+
+inline int PackedFishes::species(int index) const
+{
+	return m_fishes[index].species;
+}
@@ -0,0 +1,124 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Predators.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Predators look at the school through a bins^3 density histogram around them
+static const int bins = 4;
+
+const std::vector<Fish>& Predators::getPredators() const
+{
+	return m_predators;
+}
+
+const PredatorConfig& Predators::getConfig() const
+{
+	return m_config;
+}
+
+void Predators::setConfig(const PredatorConfig& config)
+{
+	m_config = config;
+}
+
+void Predators::add(const Fish& predator)
+{
+	m_predators.push_back(predator);
+}
+
+void Predators::clear()
+{
+	m_predators.clear();
+	m_fleePositions.clear();
+}
+
+Vector3 Predators::densestTarget(Vector3 position, const std::vector<Fish>& school, const SpatialIndex& index, float margin, bool& found)
+{
+	int counts[bins * bins * bins]{};
+	Vector3 sums[bins * bins * bins]{};
+	const float radius = m_config.huntRadius;
+	const float binScale = bins / (2.0f * radius);
+
+	// Only fish in cells within reach are looked at. The index may place fish up to margin from where
+	// they are now, so the query reaches that much further and the exact test below trims it.
+	m_candidates.clear();
+	index.query(position, radius + margin, school, m_candidates);
+	for (int candidate : m_candidates)
+	{
+		const Fish& fish = school[candidate];
+		Vector3 offset = Vector3Subtract(fish.getPosition(), position);
+		if (Vector3LengthSqr(offset) >= radius * radius) continue;
+		int bx = std::clamp(static_cast<int>((offset.x + radius) * binScale), 0, bins - 1);
+		int by = std::clamp(static_cast<int>((offset.y + radius) * binScale), 0, bins - 1);
+		int bz = std::clamp(static_cast<int>((offset.z + radius) * binScale), 0, bins - 1);
+		int bin = (bz * bins + by) * bins + bx;
+		counts[bin]++;
+		sums[bin] = Vector3Add(sums[bin], fish.getPosition());
+	}
+
+	const int densest = static_cast<int>(std::max_element(counts, counts + bins * bins * bins) - counts);
+	found = counts[densest] > 0;
+	return found ? Vector3Scale(sums[densest], 1.0f / counts[densest]) : position;
+}
+
+void Predators::hunt(const std::vector<Fish>& school, const SpatialIndex& index, float margin, const RaylibConfig& raylibConfig, float turnFactor, float deltaTime)
+{
+	// Chasing is the cohesion rule pulling towards the densest bin, walls and speed limits as for fish
+	SimulationConfig chaseConfig{};
+	chaseConfig.cohesionFactor = m_config.chaseFactor;
+	chaseConfig.turnFactor = turnFactor;
+	chaseConfig.maxSpeed = m_config.maxSpeed;
+	chaseConfig.minSpeed = m_config.minSpeed;
+
+	// A query can return the whole school, sizing the candidates for that once keeps later steps from allocating
+	if (!m_predators.empty() && m_candidates.capacity() < school.size())
+		m_candidates.reserve(school.size());
+	m_fleePositions.clear();
+	for (Fish& predator : m_predators)
+	{
+		bool found = false;
+		NeighborSums sums;
+		sums.positionSum = densestTarget(predator.getPosition(), school, index, margin, found);
+		sums.cohesionWeight = found ? 1.0f : 0.0f;
+		predator.update(sums, chaseConfig, raylibConfig, deltaTime);
+		if (raylibConfig.boundary == Boundary::Periodic)
+			predator.wrap(raylibConfig);
+		m_fleePositions.push_back(predator.getPosition());
+	}
+
+	if (m_fleePositions.empty())
+		return;
+	m_fleeMin = m_fleePositions[0];
+	m_fleeMax = m_fleePositions[0];
+	for (Vector3 position : m_fleePositions)
+	{
+		m_fleeMin = Vector3Min(m_fleeMin, position);
+		m_fleeMax = Vector3Max(m_fleeMax, position);
+	}
+	m_fleeMin = Vector3SubtractValue(m_fleeMin, m_config.fleeRadius);
+	m_fleeMax = Vector3AddValue(m_fleeMax, m_config.fleeRadius);
+}
+
+Vector3 Predators::flee(Vector3 position) const
+{
+	Vector3 steering{};
+	if (m_fleePositions.empty()
+		|| position.x < m_fleeMin.x || position.y < m_fleeMin.y || position.z < m_fleeMin.z
+		|| position.x > m_fleeMax.x || position.y > m_fleeMax.y || position.z > m_fleeMax.z)
+		return steering;
+
+	// Push straight away from every predator in range, harder the closer it is
+	const float fleeRadiusSqr = m_config.fleeRadius * m_config.fleeRadius;
+	for (Vector3 predator : m_fleePositions)
+	{
+		Vector3 away = Vector3Subtract(position, predator);
+		float distSqr = Vector3LengthSqr(away);
+		if (distSqr >= fleeRadiusSqr || distSqr == 0.0f) continue;
+		float dist = std::sqrt(distSqr);
+		float strength = m_config.fleeFactor * (1.0f - dist / m_config.fleeRadius) / dist;
+		steering = Vector3Add(steering, Vector3Scale(away, strength));
+	}
+	return steering;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+
+struct PredatorConfig {
+	float huntRadius{};
+	float chaseFactor{};
+	float fleeRadius{};
+	float fleeFactor{};
+	float maxSpeed{};
+	float minSpeed{};
+};
+
+// The few predators of a flock. They are kept out of the school's spatial index: each step they
+// chase the densest part of the school around them, found by querying that index, and fish test a
+// broadcast list of their positions for the flee rule. A box around all predators lets fish far from every predator skip
+// the test, so the school pays next to nothing for predators it cannot see.
+class Predators
+{
+private:
+	std::vector<Fish> m_predators;
+	PredatorConfig m_config{};
+	std::vector<Vector3> m_fleePositions;
+	Vector3 m_fleeMin{};
+	Vector3 m_fleeMax{};
+	std::vector<int> m_candidates;
+
+	Vector3 densestTarget(Vector3 position, const std::vector<Fish>& school, const SpatialIndex& index, float margin, bool& found);
+
+public:
+	const std::vector<Fish>& getPredators() const;
+	const PredatorConfig& getConfig() const;
+	void setConfig(const PredatorConfig& config);
+	void add(const Fish& predator);
+	void clear();
+	void hunt(const std::vector<Fish>& school, const SpatialIndex& index, float margin, const RaylibConfig& raylibConfig, float turnFactor, float deltaTime);
+	Vector3 flee(Vector3 position) const;
+};
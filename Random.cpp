@@ -0,0 +1,109 @@
+#include "Random.h"
+#include <vector>
+
+static const unsigned philoxM0 = 0xD2511F53u;
+static const unsigned philoxM1 = 0xCD9E8D57u;
+static const unsigned philoxW0 = 0x9E3779B9u;
+static const unsigned philoxW1 = 0xBB67AE85u;
+
+// Top 24 bits to a float in [0, 1)
+static float toUnit(unsigned bits)
+{
+	return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+Random::Random(unsigned long long seed, unsigned stream) : m_seed{ seed }, m_stream{ stream } {};
+
+Random Random::stream(unsigned stream) const
+{
+	return Random{ m_seed, stream };
+}
+
+unsigned long long Random::getSeed() const
+{
+	return m_seed;
+}
+
+unsigned Random::getStream() const
+{
+	return m_stream;
+}
+
+unsigned long long Random::getCounter() const
+{
+	return m_counter;
+}
+
+void Random::setCounter(unsigned long long counter)
+{
+	m_counter = counter;
+}
+
+void Random::block(unsigned long long index, unsigned result[4]) const
+{
+	// Counter is (index, stream, 0), key is the seed; ten rounds of multiply and xor
+	unsigned c0 = static_cast<unsigned>(index);
+	unsigned c1 = static_cast<unsigned>(index >> 32);
+	unsigned c2 = m_stream;
+	unsigned c3 = 0;
+	unsigned k0 = static_cast<unsigned>(m_seed);
+	unsigned k1 = static_cast<unsigned>(m_seed >> 32);
+	for (int round = 0; round < 10; round++)
+	{
+		unsigned long long product0 = static_cast<unsigned long long>(philoxM0) * c0;
+		unsigned long long product1 = static_cast<unsigned long long>(philoxM1) * c2;
+		unsigned hi0 = static_cast<unsigned>(product0 >> 32);
+		unsigned hi1 = static_cast<unsigned>(product1 >> 32);
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = static_cast<unsigned>(product1);
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = static_cast<unsigned>(product0);
+		k0 += philoxW0;
+		k1 += philoxW1;
+	}
+	result[0] = c0;
+	result[1] = c1;
+	result[2] = c2;
+	result[3] = c3;
+}
+
+void Random::fill(float* values, int count, unsigned long long firstBlock) const
+{
+	// Blocks are independent, so this loop has no carried state
+	const int blockCount = count / 4;
+	for (int b = 0; b < blockCount; b++)
+	{
+		unsigned bits[4];
+		block(firstBlock + b, bits);
+		for (int k = 0; k < 4; k++)
+			values[b * 4 + k] = toUnit(bits[k]);
+	}
+	if (count % 4 == 0)
+		return;
+	unsigned bits[4];
+	block(firstBlock + blockCount, bits);
+	for (int k = 0; k < count % 4; k++)
+		values[blockCount * 4 + k] = toUnit(bits[k]);
+}
+
+unsigned Random::next()
+{
+	// Sequential draws walk the same counter, four outputs per block
+	const unsigned long long blockIndex = m_counter / 4;
+	if (blockIndex != m_cachedBlock)
+	{
+		block(blockIndex, m_cache);
+		m_cachedBlock = blockIndex;
+	}
+	return m_cache[m_counter++ % 4];
+}
+
+float Random::uniform()
+{
+	return toUnit(next());
+}
+
+float Random::uniform(float min, float max)
+{
+	return min + (max - min) * uniform();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+
+// Counter-based generator (Philox4x32-10). Every output is a pure function of the seed, a stream id
+// and its index, so threads draw from their own stream without sharing state, any number can be
+// computed out of order, and a run replays exactly from its seed.
+class Random
+{
+private:
+	unsigned long long m_seed{};
+	unsigned m_stream{};
+	unsigned long long m_counter{};
+	unsigned long long m_cachedBlock{ ~0ull };
+	unsigned m_cache[4]{};
+
+public:
+	Random(unsigned long long seed = 0, unsigned stream = 0);
+	Random stream(unsigned stream) const;
+	unsigned long long getSeed() const;
+	unsigned getStream() const;
+	unsigned long long getCounter() const;
+	void setCounter(unsigned long long counter);
+	void block(unsigned long long index, unsigned result[4]) const;
+	void fill(float* values, int count, unsigned long long firstBlock) const;
+	unsigned next();
+	float uniform();
+	float uniform(float min, float max);
+};
@@ -0,0 +1,139 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "SchoolClusters.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+void SchoolClusters::reserve(int fishCount)
+{
+	// There are never more schools than fish, so labeling and bounds can not outgrow this either
+	if (fishCount <= m_capacity)
+		return;
+	m_capacity = fishCount;
+	m_parents.reset(new std::atomic<int>[m_capacity]);
+	m_clusterIds.reserve(m_capacity);
+	m_clusterSizes.reserve(m_capacity);
+	m_bounds.reserve(m_capacity);
+	m_boundsMin.reserve(m_capacity);
+	m_boundsMax.reserve(m_capacity);
+}
+
+void SchoolClusters::begin(int fishCount)
+{
+	if (fishCount > m_capacity)
+		reserve(std::max(fishCount, m_capacity * 2));
+	m_fishCount = fishCount;
+	for (int i = 0; i < fishCount; i++)
+		m_parents[i].store(i, std::memory_order_relaxed);
+}
+
+int SchoolClusters::find(int fish) const
+{
+	// Path halving with a CAS, losing the race only means the path stays a little longer
+	while (true)
+	{
+		int parent = m_parents[fish].load(std::memory_order_relaxed);
+		if (parent == fish)
+			return fish;
+		const int grandparent = m_parents[parent].load(std::memory_order_relaxed);
+		if (grandparent != parent)
+			m_parents[fish].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+		fish = grandparent;
+	}
+}
+
+void SchoolClusters::link(int fish, const int* links, int linkCount)
+{
+	for (int n = 0; n < linkCount; n++)
+	{
+		int a = find(fish);
+		int b = find(links[n]);
+		while (a != b)
+		{
+			// Only a root is ever relinked, if another thread relinked it first look again
+			int root = std::max(a, b);
+			const int target = std::min(a, b);
+			if (m_parents[root].compare_exchange_strong(root, target, std::memory_order_relaxed))
+				break;
+			a = find(a);
+			b = find(b);
+		}
+	}
+}
+
+void SchoolClusters::label()
+{
+	// Roots come before the rest of their school, so one pass in index order numbers them
+	m_clusterIds.resize(m_fishCount);
+	m_clusterSizes.clear();
+	for (int i = 0; i < m_fishCount; i++)
+	{
+		const int root = find(i);
+		if (root == i)
+		{
+			m_clusterIds[i] = static_cast<int>(m_clusterSizes.size());
+			m_clusterSizes.push_back(0);
+		}
+		else
+			m_clusterIds[i] = m_clusterIds[root];
+		m_clusterSizes[m_clusterIds[i]]++;
+	}
+}
+
+void SchoolClusters::beginBounds()
+{
+	const size_t clusterCount = m_clusterSizes.size();
+	m_bounds.assign(clusterCount, ClusterBounds{});
+	m_boundsMin.assign(clusterCount, Vector3{ INFINITY, INFINITY, INFINITY });
+	m_boundsMax.assign(clusterCount, Vector3{ -INFINITY, -INFINITY, -INFINITY });
+}
+
+void SchoolClusters::grow(int fish, Vector3 position, Vector3 velocity)
+{
+	const int cluster = m_clusterIds[fish];
+	m_boundsMin[cluster] = Vector3Min(m_boundsMin[cluster], position);
+	m_boundsMax[cluster] = Vector3Max(m_boundsMax[cluster], position);
+	m_bounds[cluster].velocity = Vector3Add(m_bounds[cluster].velocity, velocity);
+}
+
+void SchoolClusters::finishBounds()
+{
+	// The sphere around the box is looser than the smallest one but takes a single pass
+	for (size_t c = 0; c < m_bounds.size(); c++)
+	{
+		m_bounds[c].center = Vector3Scale(Vector3Add(m_boundsMin[c], m_boundsMax[c]), 0.5f);
+		m_bounds[c].radius = Vector3Distance(m_boundsMin[c], m_boundsMax[c]) * 0.5f;
+		m_bounds[c].velocity = Vector3Scale(m_bounds[c].velocity, 1.0f / m_clusterSizes[c]);
+	}
+}
+
+void SchoolClusters::clear()
+{
+	// Fish were added or removed, ids no longer match fish indices until the next step labels them
+	m_clusterIds.clear();
+	m_clusterSizes.clear();
+	m_bounds.clear();
+}
+
+int SchoolClusters::getClusterCount() const
+{
+	return static_cast<int>(m_clusterSizes.size());
+}
+
+const std::vector<int>& SchoolClusters::getClusterIds() const
+{
+	return m_clusterIds;
+}
+
+const std::vector<int>& SchoolClusters::getClusterSizes() const
+{
+	return m_clusterSizes;
+}
+
+const std::vector<ClusterBounds>& SchoolClusters::getBounds() const
+{
+	return m_bounds;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "raylib.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+
+// Sphere around a school and the school's mean velocity
+struct ClusterBounds {
+	Vector3 center{};
+	float radius{};
+	Vector3 velocity{};
+};
+
+// Connected components of the alignment radius neighbor graph, one per school. Links come straight
+// from the neighbor loop and may be added from several threads at once: the union-find is lock-free,
+// always hanging the larger root under the smaller one, so each school's root is its lowest fish
+// index whatever order links arrive in. label() then numbers schools densely in that order.
+// Bounds are grown fish by fish as integration writes their new state, so they describe the school
+// where the next step finds it.
+class SchoolClusters
+{
+private:
+	std::unique_ptr<std::atomic<int>[]> m_parents;
+	int m_capacity{};
+	int m_fishCount{};
+	std::vector<int> m_clusterIds;
+	std::vector<int> m_clusterSizes;
+	std::vector<ClusterBounds> m_bounds;
+	std::vector<Vector3> m_boundsMin;
+	std::vector<Vector3> m_boundsMax;
+
+	int find(int fish) const;
+
+public:
+	void reserve(int fishCount);
+	void begin(int fishCount);
+	void link(int fish, const int* links, int linkCount);
+	void label();
+	void beginBounds();
+	void grow(int fish, Vector3 position, Vector3 velocity);
+	void finishBounds();
+	void clear();
+	int getClusterCount() const;
+	const std::vector<int>& getClusterIds() const;
+	const std::vector<int>& getClusterSizes() const;
+	const std::vector<ClusterBounds>& getBounds() const;
+};
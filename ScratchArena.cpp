@@ -0,0 +1,64 @@
+#include "ScratchArena.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// Blocks start at a cache line boundary so aligned arrays stay aligned whatever block they land in
+static const size_t blockAlignment = 64;
+
+static unsigned char* alignUp(unsigned char* pointer, size_t alignment)
+{
+	const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+	return reinterpret_cast<unsigned char*>((address + alignment - 1) & ~(alignment - 1));
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment)
+{
+	if (m_block)
+	{
+		unsigned char* start = alignUp(m_block.get() + m_used, alignment);
+		if (start + bytes <= m_block.get() + m_capacity)
+		{
+			m_used = start + bytes - m_block.get();
+			m_highWater = std::max(m_highWater, m_used + m_overflowUsed);
+			return start;
+		}
+	}
+
+	// Out of room: this step gets a block of its own, the next reset() folds it into the main one
+	const size_t padded = bytes + std::max(alignment, blockAlignment);
+	m_overflow.emplace_back(new unsigned char[padded]);
+	m_overflowUsed += padded;
+	m_highWater = std::max(m_highWater, m_used + m_overflowUsed);
+	return alignUp(m_overflow.back().get(), alignment);
+}
+
+void ScratchArena::reset()
+{
+	if (!m_overflow.empty())
+	{
+		// Half again the high-water mark, so a slowly growing step does not regrow every time
+		m_overflow.clear();
+		m_capacity = m_highWater + m_highWater / 2 + blockAlignment;
+		m_block.reset(new unsigned char[m_capacity]);
+	}
+	m_used = m_block ? alignUp(m_block.get(), blockAlignment) - m_block.get() : 0;
+	m_overflowUsed = 0;
+}
+
+size_t ScratchArena::getUsed() const
+{
+	return m_used + m_overflowUsed;
+}
+
+size_t ScratchArena::getCapacity() const
+{
+	return m_capacity;
+}
+
+size_t ScratchArena::getHighWater() const
+{
+	return m_highWater;
+}
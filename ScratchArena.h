@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for memory that lives for one step. Allocating moves a cursor, reset() rewinds it
+// and nothing is freed on its own. A step that outgrows the block borrows overflow blocks; the next
+// reset() replaces them all with one block sized to the high-water mark, so once steps stop growing
+// the arena never touches the heap.
+class ScratchArena
+{
+private:
+	std::unique_ptr<unsigned char[]> m_block;
+	size_t m_capacity{};
+	size_t m_used{};
+	std::vector<std::unique_ptr<unsigned char[]>> m_overflow;
+	size_t m_overflowUsed{};
+	size_t m_highWater{};
+
+public:
+	ScratchArena() = default;
+	ScratchArena(ScratchArena&&) = default;
+	ScratchArena& operator=(ScratchArena&&) = default;
+	void* allocate(size_t bytes, size_t alignment);
+	template<typename T> T* allocate(int count);
+	void reset();
+	size_t getUsed() const;
+	size_t getCapacity() const;
+	size_t getHighWater() const;
+};
+
+// Uninitialized room for count objects, only meant for trivially destructible types
+template<typename T>
+T* ScratchArena::allocate(int count)
+{
+	return static_cast<T*>(allocate(sizeof(T) * static_cast<size_t>(count > 0 ? count : 0), alignof(T)));
+}
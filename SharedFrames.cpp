@@ -0,0 +1,340 @@
+#include "SharedFrames.h"
+#include "Flock.h"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <new>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<unsigned long long>::is_always_lock_free, "Shared frame counters must be lock free");
+static_assert(std::atomic<unsigned>::is_always_lock_free, "Shared frame sequences must be lock free");
+
+static const unsigned long long sharedAlignment = 64;
+
+static unsigned long long alignShared(unsigned long long offset)
+{
+	return (offset + sharedAlignment - 1) / sharedAlignment * sharedAlignment;
+}
+
+SharedMemory::~SharedMemory()
+{
+	close();
+}
+
+bool SharedMemory::create(const char* name, size_t size)
+{
+	close();
+#ifdef _WIN32
+	// Mapping names have no leading slash and are local to the session
+	char mappingName[80];
+	std::snprintf(mappingName, sizeof(mappingName), "Local\\%s", name[0] == '/' ? name + 1 : name);
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32), static_cast<DWORD>(size), mappingName);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+	if (!data)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		return false;
+	}
+	m_mapping = mapping;
+#else
+	// Start from a fresh object, readers still mapping an old one keep it until they close
+	shm_unlink(name);
+	int descriptor = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (descriptor < 0)
+		return false;
+	void* data = ftruncate(descriptor, static_cast<off_t>(size)) == 0
+		? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+	if (data == MAP_FAILED)
+	{
+		::close(descriptor);
+		shm_unlink(name);
+		return false;
+	}
+	m_descriptor = descriptor;
+#endif
+	m_data = static_cast<unsigned char*>(data);
+	m_size = size;
+	m_owner = true;
+	std::strncpy(m_name, name, sizeof(m_name) - 1);
+	return true;
+}
+
+bool SharedMemory::open(const char* name)
+{
+	close();
+#ifdef _WIN32
+	char mappingName[80];
+	std::snprintf(mappingName, sizeof(mappingName), "Local\\%s", name[0] == '/' ? name + 1 : name);
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	MEMORY_BASIC_INFORMATION info{};
+	if (!data || !VirtualQuery(data, &info, sizeof(info)))
+	{
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		return false;
+	}
+	m_mapping = mapping;
+	m_size = info.RegionSize;
+#else
+	int descriptor = shm_open(name, O_RDONLY, 0);
+	if (descriptor < 0)
+		return false;
+	struct stat status {};
+	void* data = fstat(descriptor, &status) == 0 && status.st_size > 0
+		? mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+	if (data == MAP_FAILED)
+	{
+		::close(descriptor);
+		return false;
+	}
+	m_descriptor = descriptor;
+	m_size = static_cast<size_t>(status.st_size);
+#endif
+	m_data = static_cast<unsigned char*>(data);
+	m_owner = false;
+	return true;
+}
+
+void SharedMemory::close()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	m_mapping = nullptr;
+#else
+	munmap(m_data, m_size);
+	::close(m_descriptor);
+	m_descriptor = -1;
+	if (m_owner)
+		shm_unlink(m_name);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_owner = false;
+}
+
+unsigned char* SharedMemory::data() const
+{
+	return m_data;
+}
+
+size_t SharedMemory::size() const
+{
+	return m_size;
+}
+
+const char* SharedFrames::magic()
+{
+	return "SARDSHM";
+}
+
+unsigned SharedFrames::version()
+{
+	return 2;
+}
+
+const char* SharedFrames::defaultName()
+{
+	return "/sardine.frames";
+}
+
+unsigned long long SharedFrames::slotBytes(unsigned capacity)
+{
+	const unsigned long long arrayBytes = alignShared(static_cast<unsigned long long>(capacity) * sizeof(float));
+	return alignShared(sizeof(SharedFrameSlot)) + arrayBytes * 7;
+}
+
+// Byte offsets of a slot and of its columns in the mapping, positions and velocities then species
+static unsigned long long slotOffset(const SharedFrameHeader* header, unsigned slot)
+{
+	return alignShared(sizeof(SharedFrameHeader)) + slot * header->slotBytes;
+}
+
+static unsigned long long columnOffset(const SharedFrameHeader* header, unsigned slot, int column)
+{
+	const unsigned long long arrayBytes = alignShared(static_cast<unsigned long long>(header->capacity) * sizeof(float));
+	return slotOffset(header, slot) + alignShared(sizeof(SharedFrameSlot)) + arrayBytes * column;
+}
+
+SharedFrameView SharedFrames::view(const unsigned char* data, unsigned slot)
+{
+	const SharedFrameHeader* header = reinterpret_cast<const SharedFrameHeader*>(data);
+	SharedFrameView view;
+	view.slot = reinterpret_cast<const SharedFrameSlot*>(data + slotOffset(header, slot));
+	view.positionX = reinterpret_cast<const float*>(data + columnOffset(header, slot, 0));
+	view.positionY = reinterpret_cast<const float*>(data + columnOffset(header, slot, 1));
+	view.positionZ = reinterpret_cast<const float*>(data + columnOffset(header, slot, 2));
+	view.velocityX = reinterpret_cast<const float*>(data + columnOffset(header, slot, 3));
+	view.velocityY = reinterpret_cast<const float*>(data + columnOffset(header, slot, 4));
+	view.velocityZ = reinterpret_cast<const float*>(data + columnOffset(header, slot, 5));
+	view.species = reinterpret_cast<const int*>(data + columnOffset(header, slot, 6));
+	return view;
+}
+
+SharedFrameWriter SharedFrames::writer(unsigned char* data, unsigned slot)
+{
+	const SharedFrameHeader* header = reinterpret_cast<const SharedFrameHeader*>(data);
+	SharedFrameWriter writer;
+	writer.slot = reinterpret_cast<SharedFrameSlot*>(data + slotOffset(header, slot));
+	writer.positionX = reinterpret_cast<float*>(data + columnOffset(header, slot, 0));
+	writer.positionY = reinterpret_cast<float*>(data + columnOffset(header, slot, 1));
+	writer.positionZ = reinterpret_cast<float*>(data + columnOffset(header, slot, 2));
+	writer.velocityX = reinterpret_cast<float*>(data + columnOffset(header, slot, 3));
+	writer.velocityY = reinterpret_cast<float*>(data + columnOffset(header, slot, 4));
+	writer.velocityZ = reinterpret_cast<float*>(data + columnOffset(header, slot, 5));
+	writer.species = reinterpret_cast<int*>(data + columnOffset(header, slot, 6));
+	return writer;
+}
+
+bool SharedFramePublisher::open(const char* name, unsigned capacity, unsigned slotCount)
+{
+	close();
+	if (capacity == 0 || slotCount == 0)
+		return false;
+	const unsigned long long slotBytes = SharedFrames::slotBytes(capacity);
+	if (!m_memory.create(name, static_cast<size_t>(alignShared(sizeof(SharedFrameHeader)) + slotBytes * slotCount)))
+		return false;
+
+	// Fresh mappings are zeroed, so every slot starts with an even sequence and no frame.
+	// The magic goes in last so a reader never sees a half written header.
+	m_header = new (m_memory.data()) SharedFrameHeader{};
+	m_header->version = SharedFrames::version();
+	m_header->slotCount = slotCount;
+	m_header->capacity = capacity;
+	m_header->slotBytes = slotBytes;
+	for (unsigned slot = 0; slot < slotCount; slot++)
+		new (m_memory.data() + alignShared(sizeof(SharedFrameHeader)) + slot * slotBytes) SharedFrameSlot{};
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(m_header->magic, SharedFrames::magic(), sizeof(m_header->magic));
+	m_published = 0;
+	return true;
+}
+
+void SharedFramePublisher::publish(const Flock& flock)
+{
+	if (!m_header)
+		return;
+	const std::vector<Fish>& fishes = flock.getFishes();
+	const unsigned fishCount = std::min(static_cast<unsigned>(fishes.size()), m_header->capacity);
+	const RaylibConfig& raylibConfig = flock.getRaylibConfig();
+
+	const SharedFrameWriter writer = SharedFrames::writer(m_memory.data(), static_cast<unsigned>(m_published % m_header->slotCount));
+	SharedFrameSlot* slot = writer.slot;
+	const unsigned sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->fishCount = fishCount;
+	slot->totalFishCount = static_cast<unsigned>(fishes.size());
+	slot->frame = m_published;
+	slot->step = flock.getStepCount();
+	slot->containerWidth = raylibConfig.containerWidth;
+	slot->containerHeight = raylibConfig.containerHeight;
+	slot->containerDepth = raylibConfig.containerDepth;
+
+	// Readers get the fish as columns, transposed straight into the slot
+	for (unsigned i = 0; i < fishCount; i++)
+	{
+		const Vector3 position = fishes[i].getPosition();
+		const Vector3 velocity = fishes[i].getVelocity();
+		writer.positionX[i] = position.x;
+		writer.positionY[i] = position.y;
+		writer.positionZ[i] = position.z;
+		writer.velocityX[i] = velocity.x;
+		writer.velocityY[i] = velocity.y;
+		writer.velocityZ[i] = velocity.z;
+		writer.species[i] = fishes[i].getSpecies();
+	}
+
+	slot->sequence.store(sequence + 2, std::memory_order_release);
+	m_published++;
+	m_header->published.store(m_published, std::memory_order_release);
+}
+
+void SharedFramePublisher::close()
+{
+	m_memory.close();
+	m_header = nullptr;
+	m_published = 0;
+}
+
+bool SharedFramePublisher::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+unsigned long long SharedFramePublisher::getPublishedCount() const
+{
+	return m_published;
+}
+
+bool SharedFrameReader::open(const char* name)
+{
+	close();
+	if (!m_memory.open(name) || m_memory.size() < sizeof(SharedFrameHeader))
+	{
+		m_memory.close();
+		return false;
+	}
+	const SharedFrameHeader* header = reinterpret_cast<const SharedFrameHeader*>(m_memory.data());
+	if (std::memcmp(header->magic, SharedFrames::magic(), sizeof(header->magic)) != 0 || header->version != SharedFrames::version()
+		|| alignShared(sizeof(SharedFrameHeader)) + header->slotBytes * header->slotCount > m_memory.size())
+	{
+		m_memory.close();
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	m_header = header;
+	return true;
+}
+
+void SharedFrameReader::close()
+{
+	m_memory.close();
+	m_header = nullptr;
+}
+
+bool SharedFrameReader::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+unsigned long long SharedFrameReader::getPublishedCount() const
+{
+	return m_header ? m_header->published.load(std::memory_order_acquire) : 0;
+}
+
+bool SharedFrameReader::latest(SharedFrameView& view) const
+{
+	const unsigned long long published = getPublishedCount();
+	if (published == 0)
+		return false;
+	const unsigned long long frame = published - 1;
+	view = SharedFrames::view(m_memory.data(), static_cast<unsigned>(frame % m_header->slotCount));
+	view.sequence = view.slot->sequence.load(std::memory_order_acquire);
+	return (view.sequence & 1) == 0 && view.slot->frame == frame;
+}
+
+bool SharedFrameReader::validate(const SharedFrameView& view) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+class Flock;
+
+// Shared memory layout: a SharedFrameHeader, then slotCount slots of slotBytes each. A slot is a
+// SharedFrameSlot followed by the position and velocity arrays and the species array, each holding
+// capacity entries from a cache line aligned offset. Frames go to slot frame % slotCount, so readers
+// always find the newest frames while the publisher never waits for them.
+struct SharedFrameHeader {
+	char magic[8]{};
+	unsigned version{};
+	unsigned slotCount{};
+	unsigned capacity{};
+	unsigned reserved{};
+	unsigned long long slotBytes{};
+	std::atomic<unsigned long long> published{};
+};
+
+// The sequence is odd while the slot is being written. A reader checks it is even before reading
+// and unchanged after, otherwise the publisher lapped it and the frame is torn.
+struct SharedFrameSlot {
+	std::atomic<unsigned> sequence{};
+	unsigned fishCount{};
+	unsigned totalFishCount{};
+	unsigned reserved{};
+	unsigned long long frame{};
+	unsigned long long step{};
+	float containerWidth{};
+	float containerHeight{};
+	float containerDepth{};
+};
+
+// Arrays of one slot in place in the mapping
+struct SharedFrameView {
+	const SharedFrameSlot* slot{};
+	unsigned sequence{};
+	const float* positionX{};
+	const float* positionY{};
+	const float* positionZ{};
+	const float* velocityX{};
+	const float* velocityY{};
+	const float* velocityZ{};
+	const int* species{};
+};
+
+// The same arrays, writable, for the publisher
+struct SharedFrameWriter {
+	SharedFrameSlot* slot{};
+	float* positionX{};
+	float* positionY{};
+	float* positionZ{};
+	float* velocityX{};
+	float* velocityY{};
+	float* velocityZ{};
+	int* species{};
+};
+
+// Named shared memory, created writable by the publisher and mapped read-only by readers.
+// POSIX shm_open where available, a named file mapping on Windows.
+class SharedMemory
+{
+private:
+	unsigned char* m_data{};
+	size_t m_size{};
+	bool m_owner{};
+	char m_name[64]{};
+#ifdef _WIN32
+	void* m_mapping{};
+#else
+	int m_descriptor{ -1 };
+#endif
+
+public:
+	SharedMemory() = default;
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+	~SharedMemory();
+	bool create(const char* name, size_t size);
+	bool open(const char* name);
+	void close();
+	unsigned char* data() const;
+	size_t size() const;
+};
+
+// Shared frame layout helpers used by both sides
+class SharedFrames
+{
+public:
+	static const char* magic();
+	static unsigned version();
+	static const char* defaultName();
+	static unsigned long long slotBytes(unsigned capacity);
+	static SharedFrameView view(const unsigned char* data, unsigned slot);
+	static SharedFrameWriter writer(unsigned char* data, unsigned slot);
+};
+
+// Copies each completed step's motion arrays into the ring. Publishing is a plain copy of the
+// arrays under the slot's sequence, so it costs the same whether or not anyone is reading.
+class SharedFramePublisher
+{
+private:
+	SharedMemory m_memory;
+	SharedFrameHeader* m_header{};
+	unsigned long long m_published{};
+
+public:
+	bool open(const char* name, unsigned capacity, unsigned slotCount = 4);
+	void close();
+	bool isOpen() const;
+	unsigned long long getPublishedCount() const;
+	void publish(const Flock& flock);
+};
+
+// Maps a ring published by another process. Frames are read in place: take the newest frame with
+// latest, read its arrays, then check the frame is still intact with validate before using results.
+class SharedFrameReader
+{
+private:
+	SharedMemory m_memory;
+	const SharedFrameHeader* m_header{};
+
+public:
+	bool open(const char* name);
+	void close();
+	bool isOpen() const;
+	unsigned long long getPublishedCount() const;
+	bool latest(SharedFrameView& view) const;
+	bool validate(const SharedFrameView& view) const;
+};
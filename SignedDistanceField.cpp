@@ -0,0 +1,233 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "SignedDistanceField.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+static float sphereDistance(Vector3 p, Vector3 center, float radius)
+{
+	return Vector3Distance(p, center) - radius;
+}
+
+static float boxDistance(Vector3 p, Vector3 center, Vector3 halfSize)
+{
+	Vector3 offset = Vector3Subtract(p, center);
+	Vector3 q{ std::fabs(offset.x) - halfSize.x, std::fabs(offset.y) - halfSize.y, std::fabs(offset.z) - halfSize.z };
+	float outside = Vector3Length(Vector3Max(q, Vector3Zero()));
+	float inside = std::min(std::max({ q.x, q.y, q.z }), 0.0f);
+	return outside + inside;
+}
+
+// Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+static Vector3 closestOnTriangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c)
+{
+	Vector3 ab = Vector3Subtract(b, a);
+	Vector3 ac = Vector3Subtract(c, a);
+	Vector3 ap = Vector3Subtract(p, a);
+	float d1 = Vector3DotProduct(ab, ap);
+	float d2 = Vector3DotProduct(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	Vector3 bp = Vector3Subtract(p, b);
+	float d3 = Vector3DotProduct(ab, bp);
+	float d4 = Vector3DotProduct(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return Vector3Add(a, Vector3Scale(ab, d1 / (d1 - d3)));
+
+	Vector3 cp = Vector3Subtract(p, c);
+	float d5 = Vector3DotProduct(ab, cp);
+	float d6 = Vector3DotProduct(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return Vector3Add(a, Vector3Scale(ac, d2 / (d2 - d6)));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		return Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+	float denom = 1.0f / (va + vb + vc);
+	return Vector3Add(a, Vector3Add(Vector3Scale(ab, vb * denom), Vector3Scale(ac, vc * denom)));
+}
+
+const ObstacleConfig& SignedDistanceField::getConfig() const
+{
+	return m_config;
+}
+
+void SignedDistanceField::setConfig(const ObstacleConfig& config)
+{
+	m_config = config;
+}
+
+void SignedDistanceField::addSphere(Vector3 center, float radius)
+{
+	m_spheres.push_back(Sphere{ center, radius });
+}
+
+void SignedDistanceField::addBox(Vector3 center, Vector3 size)
+{
+	m_boxes.push_back(Box{ center, Vector3Scale(size, 0.5f) });
+}
+
+void SignedDistanceField::addMesh(const Mesh& mesh, Matrix transform)
+{
+	for (int t = 0; t < mesh.triangleCount; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int vertex = mesh.indices ? mesh.indices[t * 3 + corner] : t * 3 + corner;
+			Vector3 position{ mesh.vertices[vertex * 3], mesh.vertices[vertex * 3 + 1], mesh.vertices[vertex * 3 + 2] };
+			m_triangles.push_back(Vector3Transform(position, transform));
+		}
+	}
+}
+
+void SignedDistanceField::clear()
+{
+	m_spheres.clear();
+	m_boxes.clear();
+	m_triangles.clear();
+	m_distances.clear();
+}
+
+bool SignedDistanceField::empty() const
+{
+	return m_distances.empty();
+}
+
+int SignedDistanceField::sampleIndex(int x, int y, int z) const
+{
+	return (z * (m_dimY + 1) + y) * (m_dimX + 1) + x;
+}
+
+void SignedDistanceField::bakeTriangle(Vector3 a, Vector3 b, Vector3 c, std::vector<float>& unsignedBand, std::vector<float>& meshDistances) const
+{
+	// Only samples within the band around the triangle's bounds can be affected
+	const float band = m_config.avoidDistance;
+	Vector3 lo = Vector3SubtractValue(Vector3Min(a, Vector3Min(b, c)), band);
+	Vector3 hi = Vector3AddValue(Vector3Max(a, Vector3Max(b, c)), band);
+	const int x0 = std::max(static_cast<int>(std::ceil((lo.x - m_origin.x) / m_cellSize)), 0);
+	const int y0 = std::max(static_cast<int>(std::ceil((lo.y - m_origin.y) / m_cellSize)), 0);
+	const int z0 = std::max(static_cast<int>(std::ceil((lo.z - m_origin.z) / m_cellSize)), 0);
+	const int x1 = std::min(static_cast<int>(std::floor((hi.x - m_origin.x) / m_cellSize)), m_dimX);
+	const int y1 = std::min(static_cast<int>(std::floor((hi.y - m_origin.y) / m_cellSize)), m_dimY);
+	const int z1 = std::min(static_cast<int>(std::floor((hi.z - m_origin.z) / m_cellSize)), m_dimZ);
+	const Vector3 normal = Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a));
+
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				Vector3 p{ m_origin.x + x * m_cellSize, m_origin.y + y * m_cellSize, m_origin.z + z * m_cellSize };
+				Vector3 closest = closestOnTriangle(p, a, b, c);
+				float dist = Vector3Distance(p, closest);
+				const int index = sampleIndex(x, y, z);
+				if (dist >= unsignedBand[index]) continue;
+
+				// Sign from the face normal of the nearest triangle
+				unsignedBand[index] = dist;
+				meshDistances[index] = Vector3DotProduct(Vector3Subtract(p, closest), normal) < 0.0f ? -dist : dist;
+			}
+		}
+	}
+}
+
+void SignedDistanceField::bake(const RaylibConfig& raylibConfig, float cellSize)
+{
+	m_cellSize = cellSize;
+	m_origin = Vector3{ -raylibConfig.containerWidth / 2, -raylibConfig.containerHeight / 2, -raylibConfig.containerDepth / 2 };
+	m_dimX = std::max(static_cast<int>(std::ceil(raylibConfig.containerWidth / cellSize)), 1);
+	m_dimY = std::max(static_cast<int>(std::ceil(raylibConfig.containerHeight / cellSize)), 1);
+	m_dimZ = std::max(static_cast<int>(std::ceil(raylibConfig.containerDepth / cellSize)), 1);
+
+	// Far from every obstacle the field saturates at the band, avoidance ignores it there
+	const float band = m_config.avoidDistance;
+	const int sampleCount = (m_dimX + 1) * (m_dimY + 1) * (m_dimZ + 1);
+	m_distances.assign(sampleCount, band);
+
+	for (int z = 0; z <= m_dimZ; z++)
+	{
+		for (int y = 0; y <= m_dimY; y++)
+		{
+			for (int x = 0; x <= m_dimX; x++)
+			{
+				Vector3 p{ m_origin.x + x * m_cellSize, m_origin.y + y * m_cellSize, m_origin.z + z * m_cellSize };
+				float dist = band;
+				for (const Sphere& sphere : m_spheres)
+					dist = std::min(dist, sphereDistance(p, sphere.center, sphere.radius));
+				for (const Box& box : m_boxes)
+					dist = std::min(dist, boxDistance(p, box.center, box.halfSize));
+				m_distances[sampleIndex(x, y, z)] = dist;
+			}
+		}
+	}
+
+	if (m_triangles.empty())
+		return;
+	std::vector<float> unsignedBand(sampleCount, band);
+	std::vector<float> meshDistances(sampleCount, band);
+	for (size_t t = 0; t + 2 < m_triangles.size(); t += 3)
+		bakeTriangle(m_triangles[t], m_triangles[t + 1], m_triangles[t + 2], unsignedBand, meshDistances);
+	for (int i = 0; i < sampleCount; i++)
+		m_distances[i] = std::min(m_distances[i], meshDistances[i]);
+}
+
+float SignedDistanceField::sample(Vector3 position, Vector3& gradient) const
+{
+	// Cell and fractional position inside it, clamped to the baked volume
+	float gx = std::clamp((position.x - m_origin.x) / m_cellSize, 0.0f, static_cast<float>(m_dimX));
+	float gy = std::clamp((position.y - m_origin.y) / m_cellSize, 0.0f, static_cast<float>(m_dimY));
+	float gz = std::clamp((position.z - m_origin.z) / m_cellSize, 0.0f, static_cast<float>(m_dimZ));
+	int x = std::min(static_cast<int>(gx), m_dimX - 1);
+	int y = std::min(static_cast<int>(gy), m_dimY - 1);
+	int z = std::min(static_cast<int>(gz), m_dimZ - 1);
+	float fx = gx - x;
+	float fy = gy - y;
+	float fz = gz - z;
+
+	float c000 = m_distances[sampleIndex(x, y, z)];
+	float c100 = m_distances[sampleIndex(x + 1, y, z)];
+	float c010 = m_distances[sampleIndex(x, y + 1, z)];
+	float c110 = m_distances[sampleIndex(x + 1, y + 1, z)];
+	float c001 = m_distances[sampleIndex(x, y, z + 1)];
+	float c101 = m_distances[sampleIndex(x + 1, y, z + 1)];
+	float c011 = m_distances[sampleIndex(x, y + 1, z + 1)];
+	float c111 = m_distances[sampleIndex(x + 1, y + 1, z + 1)];
+
+	// Trilinear value and its analytic derivative from the same eight samples
+	float c00 = c000 + (c100 - c000) * fx;
+	float c10 = c010 + (c110 - c010) * fx;
+	float c01 = c001 + (c101 - c001) * fx;
+	float c11 = c011 + (c111 - c011) * fx;
+	float c0 = c00 + (c10 - c00) * fy;
+	float c1 = c01 + (c11 - c01) * fy;
+
+	float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+	float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+	gradient.x = (dx0 + (dx1 - dx0) * fz) / m_cellSize;
+	gradient.y = ((c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz) / m_cellSize;
+	gradient.z = (c1 - c0) / m_cellSize;
+	return c0 + (c1 - c0) * fz;
+}
+
+Vector3 SignedDistanceField::avoid(Vector3 position) const
+{
+	if (m_distances.empty())
+		return Vector3Zero();
+
+	// Push along the gradient, harder the closer to the surface and full strength inside
+	Vector3 gradient{};
+	float dist = sample(position, gradient);
+	if (dist >= m_config.avoidDistance)
+		return Vector3Zero();
+	float strength = m_config.avoidFactor * std::min(1.0f - dist / m_config.avoidDistance, 1.0f);
+	return Vector3Scale(Vector3Normalize(gradient), strength);
+}
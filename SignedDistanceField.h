@@ -0,0 +1,53 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include <vector>
+
+struct ObstacleConfig {
+	float avoidDistance{};
+	float avoidFactor{};
+};
+
+// Static obstacles baked into a signed distance field sampled on a grid over the container.
+// Spheres and boxes are exact everywhere; meshes are baked in a narrow band of avoidDistance around
+// their triangles, which is all avoidance looks at. Steering a fish is then one trilinear lookup
+// and its gradient no matter how many obstacles or triangles went in.
+class SignedDistanceField
+{
+private:
+	struct Sphere {
+		Vector3 center{};
+		float radius{};
+	};
+	struct Box {
+		Vector3 center{};
+		Vector3 halfSize{};
+	};
+
+	ObstacleConfig m_config{};
+	std::vector<Sphere> m_spheres;
+	std::vector<Box> m_boxes;
+	std::vector<Vector3> m_triangles;
+
+	Vector3 m_origin{};
+	float m_cellSize{};
+	int m_dimX{};
+	int m_dimY{};
+	int m_dimZ{};
+	std::vector<float> m_distances;
+
+	int sampleIndex(int x, int y, int z) const;
+	void bakeTriangle(Vector3 a, Vector3 b, Vector3 c, std::vector<float>& unsignedBand, std::vector<float>& meshDistances) const;
+
+public:
+	const ObstacleConfig& getConfig() const;
+	void setConfig(const ObstacleConfig& config);
+	void addSphere(Vector3 center, float radius);
+	void addBox(Vector3 center, Vector3 size);
+	void addMesh(const Mesh& mesh, Matrix transform);
+	void clear();
+	bool empty() const;
+	void bake(const RaylibConfig& raylibConfig, float cellSize);
+	float sample(Vector3 position, Vector3& gradient) const;
+	Vector3 avoid(Vector3 position) const;
+};
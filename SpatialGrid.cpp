@@ -0,0 +1,127 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "SpatialGrid.h"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+
+void SpatialGrid::build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize)
+{
+	m_layout = GridLayout::fit(raylibConfig, minCellSize);
+	const int cellCount = m_layout.cellCount();
+	const int fishCount = static_cast<int>(fishes.size());
+	m_cellStart.assign(cellCount + 1, 0);
+	m_fishCell.resize(fishCount);
+	m_indices.resize(fishCount);
+
+	// Counting sort: histogram, exclusive prefix sum, scatter
+	for (int i = 0; i < fishCount; i++)
+	{
+		m_fishCell[i] = m_layout.cellOf(fishes[i].getPosition());
+		m_cellStart[m_fishCell[i] + 1]++;
+	}
+	for (int c = 0; c < cellCount; c++)
+		m_cellStart[c + 1] += m_cellStart[c];
+
+	// The scatter cursors keep their capacity across rebuilds
+	m_cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (int i = 0; i < fishCount; i++)
+		m_indices[m_cursor[m_fishCell[i]]++] = i;
+}
+
+void SpatialGrid::query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const
+{
+	// Every cell the query box touches, the 27 around the fish while the radius is within a cell
+	const float radiusSqr = radius * radius;
+	const int minX = m_layout.coordX(position.x - radius);
+	const int minY = m_layout.coordY(position.y - radius);
+	const int minZ = m_layout.coordZ(position.z - radius);
+	const int maxX = m_layout.coordX(position.x + radius);
+	const int maxY = m_layout.coordY(position.y + radius);
+	const int maxZ = m_layout.coordZ(position.z + radius);
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				int cell = m_layout.cellIndex(x, y, z);
+				for (int s = m_cellStart[cell]; s < m_cellStart[cell + 1]; s++)
+				{
+					int other = m_indices[s];
+					if (Vector3DistanceSqr(position, fishes[other].getPosition()) < radiusSqr)
+						result.push_back(other);
+				}
+			}
+		}
+	}
+}
+
+void SpatialGrid::scanCell(int cell, Vector3 position, int self, int k, const std::vector<Fish>& fishes, std::pair<float, int>* heap, int& heapSize) const
+{
+	for (int s = m_cellStart[cell]; s < m_cellStart[cell + 1]; s++)
+	{
+		int other = m_indices[s];
+		if (other == self) continue;
+		float distSqr = Vector3DistanceSqr(position, fishes[other].getPosition());
+		if (heapSize < k)
+		{
+			heap[heapSize++] = { distSqr, other };
+			std::push_heap(heap, heap + heapSize);
+		}
+		else if (distSqr < heap[0].first)
+		{
+			std::pop_heap(heap, heap + heapSize);
+			heap[heapSize - 1] = { distSqr, other };
+			std::push_heap(heap, heap + heapSize);
+		}
+	}
+}
+
+int SpatialGrid::nearest(int self, int k, const std::vector<Fish>& fishes, int* result) const
+{
+	k = std::min(k, maxNearestNeighbors);
+	std::pair<float, int> heap[maxNearestNeighbors];
+	int heapSize = 0;
+
+	const Vector3 position = fishes[self].getPosition();
+	const int cx = m_layout.coordX(position.x);
+	const int cy = m_layout.coordY(position.y);
+	const int cz = m_layout.coordZ(position.z);
+	const float minCellSize = std::min({ m_layout.cellSize.x, m_layout.cellSize.y, m_layout.cellSize.z });
+	const int maxShell = std::max({ m_layout.dimX, m_layout.dimY, m_layout.dimZ });
+
+	for (int shell = 0; shell <= maxShell; shell++)
+	{
+		// Visit only the surface of the (2 * shell + 1)^3 block of cells
+		for (int dz = -shell; dz <= shell; dz++)
+		{
+			int z = cz + dz;
+			if (z < 0 || z >= m_layout.dimZ) continue;
+			for (int dy = -shell; dy <= shell; dy++)
+			{
+				int y = cy + dy;
+				if (y < 0 || y >= m_layout.dimY) continue;
+				const bool onFace = std::abs(dz) == shell || std::abs(dy) == shell;
+				const int step = onFace || shell == 0 ? 1 : 2 * shell;
+				for (int dx = -shell; dx <= shell; dx += step)
+				{
+					int x = cx + dx;
+					if (x < 0 || x >= m_layout.dimX) continue;
+					scanCell(m_layout.cellIndex(x, y, z), position, self, k, fishes, heap, heapSize);
+				}
+			}
+		}
+
+		// Anything in a later shell is at least shell * minCellSize away
+		const float reach = shell * minCellSize;
+		if (heapSize == k && heap[0].first <= reach * reach)
+			break;
+	}
+
+	for (int n = 0; n < heapSize; n++)
+		result[n] = heap[n].second;
+	return heapSize;
+}
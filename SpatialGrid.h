@@ -0,0 +1,27 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "SpatialIndex.h"
+#include <vector>
+#include <utility>
+
+// Uniform grid over the container, rebuilt from scratch with a counting sort.
+// Nearest neighbor queries walk outwards in shells of cells and keep the k best in a fixed-size max-heap.
+static const int maxNearestNeighbors = 32;
+
+class SpatialGrid : public SpatialIndex
+{
+private:
+	GridLayout m_layout;
+	std::vector<int> m_cellStart;
+	std::vector<int> m_indices;
+	std::vector<int> m_fishCell;
+	std::vector<int> m_cursor;
+
+	void scanCell(int cell, Vector3 position, int self, int k, const std::vector<Fish>& fishes, std::pair<float, int>* heap, int& heapSize) const;
+
+public:
+	void build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize) override;
+	void query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const override;
+	int nearest(int self, int k, const std::vector<Fish>& fishes, int* result) const;
+};
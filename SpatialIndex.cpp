@@ -0,0 +1,61 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "SpatialIndex.h"
+#include <algorithm>
+
+// Keeps the cell array bounded when the radii are tiny compared to the container
+static const int maxCellsPerAxis = 128;
+
+GridLayout GridLayout::fit(const RaylibConfig& raylibConfig, float minCellSize)
+{
+	const Vector3 extent{ raylibConfig.containerWidth, raylibConfig.containerHeight, raylibConfig.containerDepth };
+	GridLayout layout;
+	layout.origin = Vector3Scale(extent, -0.5f);
+	layout.dimX = std::clamp(static_cast<int>(extent.x / minCellSize), 1, maxCellsPerAxis);
+	layout.dimY = std::clamp(static_cast<int>(extent.y / minCellSize), 1, maxCellsPerAxis);
+	layout.dimZ = std::clamp(static_cast<int>(extent.z / minCellSize), 1, maxCellsPerAxis);
+	layout.cellSize = Vector3{ extent.x / layout.dimX, extent.y / layout.dimY, extent.z / layout.dimZ };
+	return layout;
+}
+
+// Fish that drift past the walls are clamped into the border cells
+int GridLayout::coordX(float x) const
+{
+	return std::clamp(static_cast<int>((x - origin.x) / cellSize.x), 0, dimX - 1);
+}
+
+int GridLayout::coordY(float y) const
+{
+	return std::clamp(static_cast<int>((y - origin.y) / cellSize.y), 0, dimY - 1);
+}
+
+int GridLayout::coordZ(float z) const
+{
+	return std::clamp(static_cast<int>((z - origin.z) / cellSize.z), 0, dimZ - 1);
+}
+
+int GridLayout::cellIndex(int x, int y, int z) const
+{
+	return (z * dimY + y) * dimX + x;
+}
+
+int GridLayout::cellOf(Vector3 position) const
+{
+	return cellIndex(coordX(position.x), coordY(position.y), coordZ(position.z));
+}
+
+int GridLayout::cellCount() const
+{
+	return dimX * dimY * dimZ;
+}
+
+bool GridLayout::operator==(const GridLayout& other) const
+{
+	return dimX == other.dimX && dimY == other.dimY && dimZ == other.dimZ
+		&& Vector3Equals(origin, other.origin) && Vector3Equals(cellSize, other.cellSize);
+}
+
+bool GridLayout::operator!=(const GridLayout& other) const
+{
+	return !(*this == other);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include <vector>
+
+// Cell layout covering the container. Cells are at least minCellSize wide so a radius query
+// of up to minCellSize only visits the 27 surrounding cells.
+struct GridLayout {
+	Vector3 origin{};
+	Vector3 cellSize{};
+	int dimX{};
+	int dimY{};
+	int dimZ{};
+
+	static GridLayout fit(const RaylibConfig& raylibConfig, float minCellSize);
+	int coordX(float x) const;
+	int coordY(float y) const;
+	int coordZ(float z) const;
+	int cellIndex(int x, int y, int z) const;
+	int cellOf(Vector3 position) const;
+	int cellCount() const;
+	bool operator==(const GridLayout& other) const;
+	bool operator!=(const GridLayout& other) const;
+};
+
+// Spatial index the neighbor list is built from. Predators query it with their larger hunt radius,
+// which visits every cell within reach instead of the 27 around them.
+class SpatialIndex
+{
+public:
+	virtual ~SpatialIndex() = default;
+	virtual void build(const std::vector<Fish>& fishes, const RaylibConfig& raylibConfig, float minCellSize) = 0;
+	virtual void query(Vector3 position, float radius, const std::vector<Fish>& fishes, std::vector<int>& result) const = 0;
+};
@@ -0,0 +1,76 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "Spawn.h"
+#include "Random.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Random numbers drawn per fish: four for the position, four for the heading
+static const int valuesPerFish = 8;
+
+// School centres and headings are drawn far past any fish's numbers
+static const unsigned long long schoolBlocks = 1ull << 48;
+
+// Numbers are drawn for this many fish at a time into a buffer on the stack
+static const int fishPerChunk = 64;
+
+// Three normal deviates from four uniforms by the Box-Muller transform
+static Vector3 gaussian(const float* values)
+{
+	const float twoPi = 2.0f * PI;
+	float r1 = std::sqrt(-2.0f * std::log(1.0f - values[0]));
+	float r2 = std::sqrt(-2.0f * std::log(1.0f - values[2]));
+	return Vector3{ r1 * std::cos(twoPi * values[1]), r1 * std::sin(twoPi * values[1]), r2 * std::cos(twoPi * values[3]) };
+}
+
+static Vector3 heading(const float* values)
+{
+	Vector3 direction = gaussian(values);
+	return Vector3LengthSqr(direction) > 0.0f ? Vector3Normalize(direction) : Vector3{ 1.0f, 0.0f, 0.0f };
+}
+
+void spawnFishes(std::vector<Fish>& fishes, int count, const SpawnConfig& spawnConfig)
+{
+	if (count <= 0)
+		return;
+
+	// Random numbers come from independent counters, a chunk of fish at a time. Fish i always takes
+	// blocks 2i and 2i + 1, so chunking draws the same numbers as filling the whole batch at once.
+	const Random random{ spawnConfig.seed, spawnConfig.stream };
+	const int schoolCount = spawnConfig.distribution == SpawnDistribution::Schools ? std::max(spawnConfig.schoolCount, 1) : 0;
+	const int blocksPerFish = valuesPerFish / 4;
+	float values[fishPerChunk * valuesPerFish];
+	float school[valuesPerFish];
+
+	// Grow geometrically unless there is room already, a flock with reserved capacity never reallocates here
+	if (fishes.size() + count > fishes.capacity())
+		fishes.reserve(std::max(fishes.size() + count, fishes.capacity() * 2));
+	for (int i = 0; i < count; i++)
+	{
+		if (i % fishPerChunk == 0)
+			random.fill(values, std::min(count - i, fishPerChunk) * valuesPerFish, static_cast<unsigned long long>(i) * blocksPerFish);
+		const float* fishValues = &values[(i % fishPerChunk) * valuesPerFish];
+		Vector3 offset{};
+		Vector3 direction = heading(fishValues + 4);
+		switch (spawnConfig.distribution)
+		{
+		case SpawnDistribution::UniformCube:
+			offset = Vector3Scale(Vector3{ fishValues[0] * 2.0f - 1.0f, fishValues[1] * 2.0f - 1.0f, fishValues[2] * 2.0f - 1.0f }, spawnConfig.extent);
+			break;
+		case SpawnDistribution::GaussianBall:
+			offset = Vector3Scale(gaussian(fishValues), spawnConfig.extent);
+			break;
+		case SpawnDistribution::Schools:
+		{
+			// Centre in the cube, each fish in a ball around it heading roughly the school's way
+			random.fill(school, valuesPerFish, schoolBlocks + static_cast<unsigned long long>(i % schoolCount) * blocksPerFish);
+			Vector3 centre = Vector3Scale(Vector3{ school[0] * 2.0f - 1.0f, school[1] * 2.0f - 1.0f, school[2] * 2.0f - 1.0f }, spawnConfig.extent);
+			offset = Vector3Add(centre, Vector3Scale(gaussian(fishValues), spawnConfig.schoolRadius));
+			direction = Vector3Normalize(Vector3Add(heading(school + 4), Vector3Scale(direction, 0.3f)));
+			break;
+		}
+		}
+		fishes.push_back(Fish{ Vector3Add(spawnConfig.center, offset), Vector3Scale(direction, spawnConfig.speed), spawnConfig.species });
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include <vector>
+
+enum class SpawnDistribution {
+	UniformCube,
+	GaussianBall,
+	Schools,
+};
+
+// Where and how fast new fish start. extent is the half size of the cube, the standard deviation
+// of the ball, or the half size of the cube school centres are picked in. Fish of a school spread
+// around its centre by schoolRadius and share its heading.
+struct SpawnConfig {
+	SpawnDistribution distribution{ SpawnDistribution::UniformCube };
+	Vector3 center{};
+	float extent{};
+	float speed{};
+	int schoolCount{ 1 };
+	float schoolRadius{};
+	int species{};
+	unsigned long long seed{};
+	unsigned stream{};
+};
+
+// Appends count fish in one call. Random numbers come from the counter-based generator, so the whole
+// batch is filled by one loop without a sequential generator, and a seed and stream always spawn the same fish.
+void spawnFishes(std::vector<Fish>& fishes, int count, const SpawnConfig& spawnConfig);
@@ -0,0 +1,135 @@
+#include "StatsExporter.h"
+#include "Flock.h"
+#include "StepStats.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+// Column order of the stats file, the histogram follows as nearest0 to nearest15
+enum StatsColumn {
+	StepColumn,
+	FishCountColumn,
+	PolarizationColumn,
+	MeanSpeedColumn,
+	ClusterCountColumn,
+	HistogramRangeColumn,
+	NearestColumn,
+};
+
+bool StatsExporter::open(const char* statsPath, const char* samplesPath, int sampleCount, int sampleInterval, int chunkRows)
+{
+	close();
+	std::vector<ArrowColumn> statsColumns{
+		{ "step", ColumnType::UInt64 },
+		{ "fishCount", ColumnType::Int32 },
+		{ "polarization", ColumnType::Float32 },
+		{ "meanSpeed", ColumnType::Float32 },
+		{ "clusterCount", ColumnType::Int32 },
+		{ "histogramRange", ColumnType::Float32 },
+	};
+	for (int bin = 0; bin < StepStats::histogramBins; bin++)
+		statsColumns.push_back(ArrowColumn{ "nearest" + std::to_string(bin), ColumnType::Int32 });
+	if (!m_stats.open(statsPath, statsColumns, chunkRows))
+		return false;
+
+	m_sampleCount = 0;
+	if (samplesPath && sampleCount > 0)
+	{
+		const std::vector<ArrowColumn> sampleColumns{
+			{ "step", ColumnType::UInt64 },
+			{ "fish", ColumnType::Int32 },
+			{ "species", ColumnType::Int32 },
+			{ "x", ColumnType::Float32 },
+			{ "y", ColumnType::Float32 },
+			{ "z", ColumnType::Float32 },
+			{ "vx", ColumnType::Float32 },
+			{ "vy", ColumnType::Float32 },
+			{ "vz", ColumnType::Float32 },
+		};
+		if (m_samples.open(samplesPath, sampleColumns, chunkRows * 16))
+		{
+			m_sampleCount = sampleCount;
+			m_sampleInterval = std::max(sampleInterval, 1);
+			m_sampleHandles.clear();
+			m_sampleHandles.reserve(sampleCount);
+		}
+	}
+	return true;
+}
+
+void StatsExporter::record(const Flock& flock)
+{
+	if (!m_stats.isOpen())
+		return;
+	const StepStats& stats = flock.getStats();
+	m_stats.append(StepColumn, stats.step);
+	m_stats.append(FishCountColumn, stats.fishCount);
+	m_stats.append(PolarizationColumn, stats.polarization);
+	m_stats.append(MeanSpeedColumn, stats.meanSpeed);
+	m_stats.append(ClusterCountColumn, stats.clusterCount);
+	m_stats.append(HistogramRangeColumn, stats.histogramRange);
+	for (int bin = 0; bin < StepStats::histogramBins; bin++)
+		m_stats.append(NearestColumn + bin, stats.nearestHistogram[bin]);
+	m_stats.endRow();
+
+	const std::vector<Fish>& fishes = flock.getFishes();
+	const int fishCount = static_cast<int>(fishes.size());
+	if (m_sampleCount == 0 || stats.step % m_sampleInterval != 0)
+		return;
+
+	// Drop removed fish, then top up from fish spread evenly over the school that are not sampled yet
+	m_sampleHandles.erase(std::remove_if(m_sampleHandles.begin(), m_sampleHandles.end(),
+		[&flock](FishHandle handle) { return flock.indexOf(handle) < 0; }), m_sampleHandles.end());
+	const int sampleCount = std::min(m_sampleCount, fishCount);
+	for (int s = 0; s < sampleCount && static_cast<int>(m_sampleHandles.size()) < sampleCount; s++)
+	{
+		const int index = static_cast<int>(static_cast<long long>(s) * fishCount / sampleCount);
+		if (!sampled(flock, index))
+			m_sampleHandles.push_back(flock.handleOf(index));
+	}
+
+	for (FishHandle handle : m_sampleHandles)
+	{
+		const Fish& fish = fishes[flock.indexOf(handle)];
+		const Vector3 position = fish.getPosition();
+		const Vector3 velocity = fish.getVelocity();
+		m_samples.append(0, stats.step);
+		m_samples.append(1, handle.slot);
+		m_samples.append(2, fish.getSpecies());
+		m_samples.append(3, position.x);
+		m_samples.append(4, position.y);
+		m_samples.append(5, position.z);
+		m_samples.append(6, velocity.x);
+		m_samples.append(7, velocity.y);
+		m_samples.append(8, velocity.z);
+		m_samples.endRow();
+	}
+}
+
+bool StatsExporter::sampled(const Flock& flock, int index) const
+{
+	for (FishHandle handle : m_sampleHandles)
+	{
+		if (flock.indexOf(handle) == index)
+			return true;
+	}
+	return false;
+}
+
+void StatsExporter::close()
+{
+	m_stats.close();
+	m_samples.close();
+	m_sampleCount = 0;
+	m_sampleHandles.clear();
+}
+
+bool StatsExporter::isOpen() const
+{
+	return m_stats.isOpen();
+}
+
+unsigned long long StatsExporter::getBytesWritten() const
+{
+	return m_stats.getBytesWritten() + (m_samples.isOpen() ? m_samples.getBytesWritten() : 0);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "ArrowWriter.h"
+#include "Flock.h"
+#include <vector>
+
+// Writes the flock's StepStats every step, and optionally the state of a few fish every
+// sampleInterval steps, as Arrow files for pandas. Statistics must be enabled on the flock.
+// Samples follow the fish picked at the first sample by handle, so the same fish are written while
+// others are removed. A sampled fish that is removed is replaced by an evenly spread pick.
+class StatsExporter
+{
+private:
+	ArrowWriter m_stats;
+	ArrowWriter m_samples;
+	int m_sampleCount{};
+	int m_sampleInterval{};
+	std::vector<FishHandle> m_sampleHandles;
+
+	bool sampled(const Flock& flock, int index) const;
+
+public:
+	bool open(const char* statsPath, const char* samplesPath = nullptr, int sampleCount = 0, int sampleInterval = 1, int chunkRows = 4096);
+	void record(const Flock& flock);
+	void close();
+	bool isOpen() const;
+	unsigned long long getBytesWritten() const;
+};
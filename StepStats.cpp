@@ -0,0 +1,50 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "StepStats.h"
+#include <algorithm>
+#include <cmath>
+
+void StepStatsAccumulator::begin(unsigned long long step, float histogramRange)
+{
+	m_stats = StepStats{};
+	m_stats.step = step;
+	m_stats.histogramRange = histogramRange;
+	m_headingSum = Vector3{};
+	m_speedSum = 0.0;
+}
+
+void StepStatsAccumulator::addFish(Vector3 velocity, float nearestDistance)
+{
+	const float speed = Vector3Length(velocity);
+	if (speed > 0.0f)
+		m_headingSum = Vector3Add(m_headingSum, Vector3Scale(velocity, 1.0f / speed));
+	m_speedSum += speed;
+
+	const int lastBin = StepStats::histogramBins - 1;
+	const int bin = nearestDistance < m_stats.histogramRange ? static_cast<int>(nearestDistance / m_stats.histogramRange * StepStats::histogramBins) : lastBin;
+	m_stats.nearestHistogram[std::min(bin, lastBin)]++;
+}
+
+void StepStatsAccumulator::merge(const StepStatsAccumulator& other)
+{
+	m_headingSum = Vector3Add(m_headingSum, other.m_headingSum);
+	m_speedSum += other.m_speedSum;
+	for (int bin = 0; bin < StepStats::histogramBins; bin++)
+		m_stats.nearestHistogram[bin] += other.m_stats.nearestHistogram[bin];
+}
+
+void StepStatsAccumulator::finish(int fishCount, int clusterCount)
+{
+	m_stats.fishCount = fishCount;
+	m_stats.clusterCount = clusterCount;
+	if (fishCount > 0)
+	{
+		m_stats.polarization = Vector3Length(m_headingSum) / fishCount;
+		m_stats.meanSpeed = static_cast<float>(m_speedSum / fishCount);
+	}
+}
+
+const StepStats& StepStatsAccumulator::getStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "raylib.h"
+
+// Aggregates of one step. Nearest neighbor distances are binned over [0, histogramRange), the last
+// bin also holds fish whose nearest neighbor is further or outside the neighbor list.
+struct StepStats {
+	static const int histogramBins = 16;
+
+	unsigned long long step{};
+	int fishCount{};
+	float polarization{};
+	float meanSpeed{};
+	int clusterCount{};
+	float histogramRange{};
+	int nearestHistogram[histogramBins]{};
+};
+
+// Builds StepStats from what the neighbor pass already has at hand for each fish: its velocity and
+// the distance to its nearest neighbor, so no second sweep over neighbors is needed. Threads
+// steering separate ranges of fish each fill their own accumulator and merge them at the end.
+class StepStatsAccumulator
+{
+private:
+	StepStats m_stats;
+	Vector3 m_headingSum{};
+	double m_speedSum{};
+
+public:
+	void begin(unsigned long long step, float histogramRange);
+	void addFish(Vector3 velocity, float nearestDistance);
+	void merge(const StepStatsAccumulator& other);
+	void finish(int fishCount, int clusterCount);
+	const StepStats& getStats() const;
+};
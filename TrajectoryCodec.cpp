@@ -0,0 +1,328 @@
+#include "raylib.h"
+#include "TrajectoryCodec.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int cellBits = 5;
+static const int cellCount = 1 << (3 * cellBits);
+static const int riceBlockSize = 256;
+static const unsigned riceEscape = 24;
+static const int channelCount = 6;
+
+// Signed residuals to unsigned so small magnitudes of either sign get short codes
+static unsigned zigzag(int value)
+{
+	return (static_cast<unsigned>(value) << 1) ^ static_cast<unsigned>(value >> 31);
+}
+
+static int unzigzag(unsigned value)
+{
+	return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+}
+
+class BitWriter
+{
+private:
+	std::vector<unsigned char>& m_bytes;
+	unsigned long long m_buffer{};
+	int m_count{};
+
+public:
+	BitWriter(std::vector<unsigned char>& bytes) : m_bytes{ bytes } {};
+
+	void write(unsigned value, int bits)
+	{
+		m_buffer |= static_cast<unsigned long long>(value) << m_count;
+		m_count += bits;
+		while (m_count >= 8)
+		{
+			m_bytes.push_back(static_cast<unsigned char>(m_buffer));
+			m_buffer >>= 8;
+			m_count -= 8;
+		}
+	}
+
+	void flush()
+	{
+		if (m_count > 0)
+			m_bytes.push_back(static_cast<unsigned char>(m_buffer));
+		m_buffer = 0;
+		m_count = 0;
+	}
+};
+
+class BitReader
+{
+private:
+	const unsigned char* m_bytes{};
+	size_t m_size{};
+	size_t m_next{};
+	unsigned long long m_buffer{};
+	int m_count{};
+
+public:
+	BitReader(const unsigned char* bytes, size_t size) : m_bytes{ bytes }, m_size{ size } {};
+
+	// Reads past the end return zeros, overrun() tells the caller afterwards
+	unsigned read(int bits)
+	{
+		while (m_count < bits)
+		{
+			unsigned long long byte = m_next < m_size ? m_bytes[m_next] : 0;
+			m_next++;
+			m_buffer |= byte << m_count;
+			m_count += 8;
+		}
+		unsigned value = static_cast<unsigned>(m_buffer & ((1ull << bits) - 1));
+		m_buffer >>= bits;
+		m_count -= bits;
+		return value;
+	}
+
+	bool overrun() const
+	{
+		return m_next > m_size;
+	}
+};
+
+static void writeRice(BitWriter& writer, const unsigned* values, int count)
+{
+	// Blocks pick their own parameter close to log2 of the mean, the best choice for geometric residuals
+	for (int first = 0; first < count; first += riceBlockSize)
+	{
+		const int last = std::min(first + riceBlockSize, count);
+		unsigned long long sum = 0;
+		for (int i = first; i < last; i++)
+			sum += values[i];
+		const double mean = static_cast<double>(sum) / (last - first) * 0.69;
+		int k = mean >= 1.0 ? std::min(static_cast<int>(std::log2(mean)), 30) : 0;
+		writer.write(static_cast<unsigned>(k), 5);
+		for (int i = first; i < last; i++)
+		{
+			const unsigned quotient = values[i] >> k;
+			if (quotient >= riceEscape)
+			{
+				writer.write((1u << riceEscape) - 1, riceEscape);
+				writer.write(values[i], 32);
+				continue;
+			}
+			writer.write((1u << quotient) - 1, quotient + 1);
+			if (k > 0)
+				writer.write(values[i] & ((1u << k) - 1), k);
+		}
+	}
+}
+
+static void readRice(BitReader& reader, unsigned* values, int count)
+{
+	for (int first = 0; first < count; first += riceBlockSize)
+	{
+		const int last = std::min(first + riceBlockSize, count);
+		const int k = static_cast<int>(reader.read(5));
+		for (int i = first; i < last; i++)
+		{
+			unsigned quotient = 0;
+			while (quotient < riceEscape && reader.read(1))
+				quotient++;
+			if (quotient == riceEscape)
+			{
+				values[i] = reader.read(32);
+				continue;
+			}
+			values[i] = (quotient << k) | (k > 0 ? reader.read(k) : 0);
+		}
+	}
+}
+
+int QuantizedFrame::size() const
+{
+	return static_cast<int>(x.size());
+}
+
+void QuantizedFrame::resize(int count)
+{
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	vz.resize(count);
+	species.resize(count);
+}
+
+const char* TrajectoryCodec::headerMagic()
+{
+	return "SARDTRAJ";
+}
+
+const char* TrajectoryCodec::footerMagic()
+{
+	return "SARDINDX";
+}
+
+unsigned TrajectoryCodec::version()
+{
+	return 3;
+}
+
+void TrajectoryCodec::quantize(const std::vector<Fish>& fishes, Vector3 low, Vector3 high, const std::vector<float>& maxSpeeds, QuantizedFrame& frame)
+{
+	// The low corner maps to 0, the high one to 65535; fish outside are clamped.
+	// Velocities map -maxSpeed to 0 and maxSpeed to 65535 per axis.
+	const Vector3 scale{ 65535.0f / (high.x - low.x), 65535.0f / (high.y - low.y), 65535.0f / (high.z - low.z) };
+	const int fishCount = static_cast<int>(fishes.size());
+	frame.low = low;
+	frame.high = high;
+	frame.resize(fishCount);
+	for (int i = 0; i < fishCount; i++)
+	{
+		const Vector3 position = fishes[i].getPosition();
+		frame.x[i] = static_cast<unsigned short>(std::clamp((position.x - low.x) * scale.x + 0.5f, 0.0f, 65535.0f));
+		frame.y[i] = static_cast<unsigned short>(std::clamp((position.y - low.y) * scale.y + 0.5f, 0.0f, 65535.0f));
+		frame.z[i] = static_cast<unsigned short>(std::clamp((position.z - low.z) * scale.z + 0.5f, 0.0f, 65535.0f));
+		const int species = fishes[i].getSpecies();
+		const Vector3 velocity = fishes[i].getVelocity();
+		const float maxSpeed = maxSpeeds[std::min(species, static_cast<int>(maxSpeeds.size()) - 1)];
+		const float velocityScale = 65535.0f / (2.0f * maxSpeed);
+		frame.vx[i] = static_cast<unsigned short>(std::clamp((velocity.x + maxSpeed) * velocityScale + 0.5f, 0.0f, 65535.0f));
+		frame.vy[i] = static_cast<unsigned short>(std::clamp((velocity.y + maxSpeed) * velocityScale + 0.5f, 0.0f, 65535.0f));
+		frame.vz[i] = static_cast<unsigned short>(std::clamp((velocity.z + maxSpeed) * velocityScale + 0.5f, 0.0f, 65535.0f));
+		frame.species[i] = static_cast<unsigned char>(species);
+	}
+}
+
+Vector3 TrajectoryCodec::dequantize(const QuantizedFrame& frame, int index)
+{
+	return Vector3{
+		frame.low.x + frame.x[index] / 65535.0f * (frame.high.x - frame.low.x),
+		frame.low.y + frame.y[index] / 65535.0f * (frame.high.y - frame.low.y),
+		frame.low.z + frame.z[index] / 65535.0f * (frame.high.z - frame.low.z) };
+}
+
+Vector3 TrajectoryCodec::dequantizeVelocity(const QuantizedFrame& frame, int index, const float* maxSpeeds)
+{
+	const float maxSpeed = maxSpeeds[frame.species[index]];
+	return Vector3{
+		(frame.vx[index] / 65535.0f * 2.0f - 1.0f) * maxSpeed,
+		(frame.vy[index] / 65535.0f * 2.0f - 1.0f) * maxSpeed,
+		(frame.vz[index] / 65535.0f * 2.0f - 1.0f) * maxSpeed };
+}
+
+void TrajectoryCodec::cellOrder(const QuantizedFrame& frame)
+{
+	// Counting sort by the top bits of each axis; encoder and decoder both run it on the previous frame
+	const int fishCount = frame.size();
+	const int shift = 16 - cellBits;
+	m_cellStart.assign(cellCount + 1, 0);
+	m_order.resize(fishCount);
+	for (int i = 0; i < fishCount; i++)
+		m_cellStart[((frame.x[i] >> shift) << (2 * cellBits) | (frame.y[i] >> shift) << cellBits | (frame.z[i] >> shift)) + 1]++;
+	for (int c = 0; c < cellCount; c++)
+		m_cellStart[c + 1] += m_cellStart[c];
+	for (int i = 0; i < fishCount; i++)
+		m_order[m_cellStart[(frame.x[i] >> shift) << (2 * cellBits) | (frame.y[i] >> shift) << cellBits | (frame.z[i] >> shift)]++] = i;
+}
+
+void TrajectoryCodec::encode(const QuantizedFrame* previous, const QuantizedFrame& frame, std::vector<unsigned char>& payload)
+{
+	const int fishCount = frame.size();
+	const std::vector<unsigned short>* channels[channelCount]{ &frame.x, &frame.y, &frame.z, &frame.vx, &frame.vy, &frame.vz };
+	payload.clear();
+	m_values.resize(static_cast<size_t>(fishCount) * channelCount);
+	if (!previous)
+	{
+		// Keyframe: the box, species as bytes, then each position and velocity axis against the fish before
+		const Vector3 box[2]{ frame.low, frame.high };
+		const unsigned char* boxBytes = reinterpret_cast<const unsigned char*>(box);
+		payload.insert(payload.end(), boxBytes, boxBytes + sizeof(box));
+		payload.insert(payload.end(), frame.species.begin(), frame.species.end());
+		for (int channel = 0; channel < channelCount; channel++)
+		{
+			int last = 0;
+			for (int i = 0; i < fishCount; i++)
+			{
+				const int value = (*channels[channel])[i];
+				m_values[channel * fishCount + i] = zigzag(value - last);
+				last = value;
+			}
+		}
+	}
+	else
+	{
+		const std::vector<unsigned short>* previousChannels[channelCount]{ &previous->x, &previous->y, &previous->z, &previous->vx, &previous->vy, &previous->vz };
+		cellOrder(*previous);
+		for (int channel = 0; channel < channelCount; channel++)
+		{
+			int lastChange = 0;
+			for (int n = 0; n < fishCount; n++)
+			{
+				const int i = m_order[n];
+				const int change = (*channels[channel])[i] - (*previousChannels[channel])[i];
+				m_values[channel * fishCount + n] = zigzag(change - lastChange);
+				lastChange = change;
+			}
+		}
+	}
+	BitWriter writer{ payload };
+	writeRice(writer, m_values.data(), static_cast<int>(m_values.size()));
+	writer.flush();
+}
+
+bool TrajectoryCodec::decode(const QuantizedFrame* previous, const unsigned char* payload, size_t payloadBytes, int fishCount, QuantizedFrame& frame)
+{
+	if (previous && previous->size() != fishCount)
+		return false;
+	frame.resize(fishCount);
+	std::vector<unsigned short>* channels[channelCount]{ &frame.x, &frame.y, &frame.z, &frame.vx, &frame.vy, &frame.vz };
+	m_values.resize(static_cast<size_t>(fishCount) * channelCount);
+	if (!previous)
+	{
+		Vector3 box[2]{};
+		const size_t headBytes = sizeof(box) + static_cast<size_t>(fishCount);
+		if (payloadBytes < headBytes)
+			return false;
+		std::memcpy(box, payload, sizeof(box));
+		if (!(box[1].x > box[0].x && box[1].y > box[0].y && box[1].z > box[0].z) || !std::isfinite(box[1].x - box[0].x) || !std::isfinite(box[1].y - box[0].y) || !std::isfinite(box[1].z - box[0].z))
+			return false;
+		frame.low = box[0];
+		frame.high = box[1];
+		std::copy(payload + sizeof(box), payload + headBytes, frame.species.begin());
+		BitReader reader{ payload + headBytes, payloadBytes - headBytes };
+		readRice(reader, m_values.data(), static_cast<int>(m_values.size()));
+		if (reader.overrun())
+			return false;
+		for (int channel = 0; channel < channelCount; channel++)
+		{
+			int last = 0;
+			for (int i = 0; i < fishCount; i++)
+			{
+				last += unzigzag(m_values[channel * fishCount + i]);
+				(*channels[channel])[i] = static_cast<unsigned short>(last);
+			}
+		}
+		return true;
+	}
+
+	BitReader reader{ payload, payloadBytes };
+	readRice(reader, m_values.data(), static_cast<int>(m_values.size()));
+	if (reader.overrun())
+		return false;
+	const std::vector<unsigned short>* previousChannels[channelCount]{ &previous->x, &previous->y, &previous->z, &previous->vx, &previous->vy, &previous->vz };
+	frame.low = previous->low;
+	frame.high = previous->high;
+	frame.species = previous->species;
+	cellOrder(*previous);
+	for (int channel = 0; channel < channelCount; channel++)
+	{
+		int change = 0;
+		for (int n = 0; n < fishCount; n++)
+		{
+			const int i = m_order[n];
+			change += unzigzag(m_values[channel * fishCount + n]);
+			(*channels[channel])[i] = static_cast<unsigned short>((*previousChannels[channel])[i] + change);
+		}
+	}
+	return true;
+}
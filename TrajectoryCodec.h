@@ -0,0 +1,81 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include <vector>
+#include <cstddef>
+
+// Trajectory file: a TrajectoryHeader and the max speed of each species, then one TrajectoryFrameHeader
+// and payload per frame.
+// Closing the recorder appends the keyframe index and a TrajectoryFooter, so a reader can seek
+// straight to the keyframe before any frame.
+struct TrajectoryHeader {
+	char magic[8]{};
+	unsigned version{};
+	unsigned keyframeInterval{};
+	float containerWidth{};
+	float containerHeight{};
+	float containerDepth{};
+	unsigned speciesCount{};
+};
+
+struct TrajectoryFrameHeader {
+	unsigned frame{};
+	unsigned fishCount{};
+	unsigned keyframe{};
+	unsigned payloadBytes{};
+};
+
+struct TrajectoryIndexEntry {
+	unsigned long long offset{};
+	unsigned frame{};
+	unsigned reserved{};
+};
+
+struct TrajectoryFooter {
+	char magic[8]{};
+	unsigned long long indexOffset{};
+	unsigned keyframeCount{};
+	unsigned frameCount{};
+};
+
+// Fish positions quantized to 16 bits per axis across a box from low to high, velocities to 16 bits
+// per axis across plus and minus their species' max speed, with their species. Keyframes store
+// their box, the frames after one reuse it.
+struct QuantizedFrame {
+	Vector3 low{};
+	Vector3 high{};
+	std::vector<unsigned short> x;
+	std::vector<unsigned short> y;
+	std::vector<unsigned short> z;
+	std::vector<unsigned short> vx;
+	std::vector<unsigned short> vy;
+	std::vector<unsigned short> vz;
+	std::vector<unsigned char> species;
+
+	int size() const;
+	void resize(int count);
+};
+
+// Frame compression. Keyframes code each fish against the previous fish. Other frames code each
+// fish's motion and velocity change since the previous frame, visiting fish in the grid cell order
+// of that frame so fish of one school follow each other, and store only how they differ from the
+// fish before. Residuals are Rice coded in blocks, each block with its own parameter.
+class TrajectoryCodec
+{
+private:
+	std::vector<int> m_order;
+	std::vector<int> m_cellStart;
+	std::vector<unsigned> m_values;
+
+	void cellOrder(const QuantizedFrame& frame);
+
+public:
+	static const char* headerMagic();
+	static const char* footerMagic();
+	static unsigned version();
+	static void quantize(const std::vector<Fish>& fishes, Vector3 low, Vector3 high, const std::vector<float>& maxSpeeds, QuantizedFrame& frame);
+	static Vector3 dequantize(const QuantizedFrame& frame, int index);
+	static Vector3 dequantizeVelocity(const QuantizedFrame& frame, int index, const float* maxSpeeds);
+	void encode(const QuantizedFrame* previous, const QuantizedFrame& frame, std::vector<unsigned char>& payload);
+	bool decode(const QuantizedFrame* previous, const unsigned char* payload, size_t payloadBytes, int fishCount, QuantizedFrame& frame);
+};
@@ -0,0 +1,172 @@
+#include "raylib.h"
+#include "raymath.h"
+#include "TrajectoryRecorder.h"
+#include <vector>
+#include <cstring>
+#include <utility>
+
+static bool sameBox(const QuantizedFrame& a, const QuantizedFrame& b)
+{
+	return a.low.x == b.low.x && a.low.y == b.low.y && a.low.z == b.low.z && a.high.x == b.high.x && a.high.y == b.high.y && a.high.z == b.high.z;
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	close();
+}
+
+bool TrajectoryRecorder::open(const char* path, const RaylibConfig& raylibConfig, const std::vector<float>& maxSpeeds, unsigned keyframeInterval)
+{
+	// Species are stored as bytes, each needs a speed range for its velocities
+	close();
+	if (maxSpeeds.empty() || maxSpeeds.size() > 256)
+		return false;
+	m_out.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_out)
+		return false;
+
+	TrajectoryHeader header;
+	std::memcpy(header.magic, TrajectoryCodec::headerMagic(), sizeof(header.magic));
+	header.version = TrajectoryCodec::version();
+	header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+	header.containerWidth = raylibConfig.containerWidth;
+	header.containerHeight = raylibConfig.containerHeight;
+	header.containerDepth = raylibConfig.containerDepth;
+	header.speciesCount = static_cast<unsigned>(maxSpeeds.size());
+	m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_out.write(reinterpret_cast<const char*>(maxSpeeds.data()), static_cast<std::streamsize>(maxSpeeds.size() * sizeof(float)));
+
+	m_raylibConfig = raylibConfig;
+	m_maxSpeeds = maxSpeeds;
+	m_high = Vector3{ raylibConfig.containerWidth * 0.5f + raylibConfig.MarginX, raylibConfig.containerHeight * 0.5f + raylibConfig.MarginY, raylibConfig.containerDepth * 0.5f + raylibConfig.MarginZ };
+	m_low = Vector3Negate(m_high);
+	m_keyframeInterval = header.keyframeInterval;
+	m_frameCount = 0;
+	m_bytesWritten = sizeof(header) + maxSpeeds.size() * sizeof(float);
+	m_previous.resize(0);
+	m_index.clear();
+	m_stopping = false;
+	m_open = true;
+	m_writer = std::thread{ &TrajectoryRecorder::write, this };
+	return true;
+}
+
+void TrajectoryRecorder::record(const std::vector<Fish>& fishes)
+{
+	if (!m_open)
+		return;
+
+	// Reuse a frame the writer is done with so steady recording does not allocate
+	QuantizedFrame frame;
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		m_wake.wait(lock, [this]() { return static_cast<int>(m_pending.size()) < maxPendingFrames; });
+		if (!m_spare.empty())
+		{
+			frame = std::move(m_spare.back());
+			m_spare.pop_back();
+		}
+	}
+
+	// Grow the box past any fish outside it by a quarter of the container, so it rarely has to grow again
+	Vector3 low = m_low;
+	Vector3 high = m_high;
+	for (const Fish& fish : fishes)
+	{
+		low = Vector3Min(low, fish.getPosition());
+		high = Vector3Max(high, fish.getPosition());
+	}
+	const Vector3 room{ m_raylibConfig.containerWidth * 0.25f, m_raylibConfig.containerHeight * 0.25f, m_raylibConfig.containerDepth * 0.25f };
+	if (low.x < m_low.x) m_low.x = low.x - room.x;
+	if (low.y < m_low.y) m_low.y = low.y - room.y;
+	if (low.z < m_low.z) m_low.z = low.z - room.z;
+	if (high.x > m_high.x) m_high.x = high.x + room.x;
+	if (high.y > m_high.y) m_high.y = high.y + room.y;
+	if (high.z > m_high.z) m_high.z = high.z + room.z;
+	TrajectoryCodec::quantize(fishes, m_low, m_high, m_maxSpeeds, frame);
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_pending.push_back(std::move(frame));
+	}
+	m_wake.notify_all();
+}
+
+void TrajectoryRecorder::write()
+{
+	std::unique_lock<std::mutex> lock{ m_mutex };
+	while (true)
+	{
+		m_wake.wait(lock, [this]() { return m_stopping || !m_pending.empty(); });
+		if (m_pending.empty())
+			break;
+		QuantizedFrame frame = std::move(m_pending.front());
+		m_pending.pop_front();
+		lock.unlock();
+		m_wake.notify_all();
+
+		writeFrame(frame);
+
+		lock.lock();
+		m_spare.push_back(std::move(frame));
+	}
+}
+
+void TrajectoryRecorder::writeFrame(QuantizedFrame& frame)
+{
+	// A keyframe every interval, and whenever fish were added or removed or changed species or the box
+	// grew, since motion is coded per fish index against the previous frame
+	const unsigned frameIndex = m_frameCount;
+	const bool keyframe = frameIndex % m_keyframeInterval == 0 || frame.size() != m_previous.size() || frame.species != m_previous.species || !sameBox(frame, m_previous);
+	m_codec.encode(keyframe ? nullptr : &m_previous, frame, m_payload);
+
+	TrajectoryFrameHeader frameHeader;
+	frameHeader.frame = frameIndex;
+	frameHeader.fishCount = static_cast<unsigned>(frame.size());
+	frameHeader.keyframe = keyframe ? 1 : 0;
+	frameHeader.payloadBytes = static_cast<unsigned>(m_payload.size());
+	if (keyframe)
+		m_index.push_back(TrajectoryIndexEntry{ m_bytesWritten, frameIndex });
+	m_out.write(reinterpret_cast<const char*>(&frameHeader), sizeof(frameHeader));
+	m_out.write(reinterpret_cast<const char*>(m_payload.data()), static_cast<std::streamsize>(m_payload.size()));
+	m_bytesWritten += sizeof(frameHeader) + m_payload.size();
+	m_frameCount++;
+	std::swap(m_previous, frame);
+}
+
+void TrajectoryRecorder::close()
+{
+	if (!m_open)
+		return;
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	m_writer.join();
+
+	// Keyframe index and footer go last, a file cut short by a crash can still be read front to back
+	TrajectoryFooter footer;
+	std::memcpy(footer.magic, TrajectoryCodec::footerMagic(), sizeof(footer.magic));
+	footer.indexOffset = m_bytesWritten;
+	footer.keyframeCount = static_cast<unsigned>(m_index.size());
+	footer.frameCount = m_frameCount;
+	m_out.write(reinterpret_cast<const char*>(m_index.data()), static_cast<std::streamsize>(m_index.size() * sizeof(TrajectoryIndexEntry)));
+	m_out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+	m_out.close();
+	m_open = false;
+}
+
+bool TrajectoryRecorder::isOpen() const
+{
+	return m_open;
+}
+
+unsigned TrajectoryRecorder::getFrameCount() const
+{
+	return m_frameCount;
+}
+
+unsigned long long TrajectoryRecorder::getBytesWritten() const
+{
+	return m_bytesWritten;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "TrajectoryCodec.h"
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Streams a flock's trajectory to disk. record() only quantizes fish on the calling thread;
+// compression and writing happen on a background thread. At most maxPendingFrames wait in the
+// queue, past that record() waits for the writer so memory stays bounded.
+// Positions are quantized across the container and its margins. Fish get past the soft walls, so a fish
+// outside that box grows it, with room to spare, and the next frame becomes a keyframe storing the new box.
+class TrajectoryRecorder
+{
+private:
+	static const int maxPendingFrames = 8;
+
+	RaylibConfig m_raylibConfig{};
+	std::vector<float> m_maxSpeeds;
+	Vector3 m_low{};
+	Vector3 m_high{};
+	unsigned m_keyframeInterval{};
+	std::ofstream m_out;
+	std::thread m_writer;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<QuantizedFrame> m_pending;
+	std::vector<QuantizedFrame> m_spare;
+	bool m_stopping{};
+	bool m_open{};
+	std::atomic<unsigned> m_frameCount{};
+	std::atomic<unsigned long long> m_bytesWritten{};
+
+	// Owned by the writer thread
+	TrajectoryCodec m_codec;
+	QuantizedFrame m_previous;
+	std::vector<unsigned char> m_payload;
+	std::vector<TrajectoryIndexEntry> m_index;
+
+	void write();
+	void writeFrame(QuantizedFrame& frame);
+
+public:
+	TrajectoryRecorder() = default;
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+	~TrajectoryRecorder();
+	bool open(const char* path, const RaylibConfig& raylibConfig, const std::vector<float>& maxSpeeds, unsigned keyframeInterval);
+	void record(const std::vector<Fish>& fishes);
+	void close();
+	bool isOpen() const;
+	unsigned getFrameCount() const;
+	unsigned long long getBytesWritten() const;
+};
@@ -0,0 +1,182 @@
+#include "raylib.h"
+#include "TrajectoryReplay.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <utility>
+
+bool TrajectoryReplay::open(const char* path)
+{
+	close();
+	if (!m_file.open(path) || m_file.size() < sizeof(TrajectoryHeader))
+		return false;
+	const TrajectoryHeader* header = reinterpret_cast<const TrajectoryHeader*>(m_file.data());
+	if (std::memcmp(header->magic, TrajectoryCodec::headerMagic(), sizeof(header->magic)) != 0 || header->version != TrajectoryCodec::version())
+	{
+		m_file.close();
+		return false;
+	}
+
+	// Species speed ranges follow the header, velocities are meaningless without a finite positive one
+	m_framesOffset = sizeof(TrajectoryHeader) + static_cast<unsigned long long>(header->speciesCount) * sizeof(float);
+	if (header->speciesCount == 0 || header->speciesCount > 256 || m_file.size() < m_framesOffset)
+	{
+		m_file.close();
+		return false;
+	}
+	m_maxSpeeds = reinterpret_cast<const float*>(m_file.data() + sizeof(TrajectoryHeader));
+	for (unsigned s = 0; s < header->speciesCount; s++)
+	{
+		if (!std::isfinite(m_maxSpeeds[s]) || m_maxSpeeds[s] <= 0.0f)
+		{
+			m_file.close();
+			return false;
+		}
+	}
+	m_header = header;
+	if (!readIndex())
+		scanFrames();
+	if (m_frameCount == 0)
+	{
+		close();
+		return false;
+	}
+	return seek(0);
+}
+
+bool TrajectoryReplay::readIndex()
+{
+	// The footer is only there if the recorder was closed cleanly
+	if (m_file.size() < m_framesOffset + sizeof(TrajectoryFooter))
+		return false;
+	TrajectoryFooter footer;
+	std::memcpy(&footer, m_file.data() + m_file.size() - sizeof(footer), sizeof(footer));
+	const unsigned long long indexBytes = static_cast<unsigned long long>(footer.keyframeCount) * sizeof(TrajectoryIndexEntry);
+	if (std::memcmp(footer.magic, TrajectoryCodec::footerMagic(), sizeof(footer.magic)) != 0
+		|| footer.indexOffset + indexBytes + sizeof(footer) != m_file.size() || footer.keyframeCount == 0)
+		return false;
+	m_keyframes.resize(footer.keyframeCount);
+	std::memcpy(m_keyframes.data(), m_file.data() + footer.indexOffset, indexBytes);
+	m_frameCount = static_cast<int>(footer.frameCount);
+	return true;
+}
+
+void TrajectoryReplay::scanFrames()
+{
+	// Walk the frame headers only, payloads are not touched
+	m_keyframes.clear();
+	m_frameCount = 0;
+	unsigned long long offset = m_framesOffset;
+	while (offset + sizeof(TrajectoryFrameHeader) <= m_file.size())
+	{
+		TrajectoryFrameHeader frameHeader;
+		std::memcpy(&frameHeader, m_file.data() + offset, sizeof(frameHeader));
+		const unsigned long long end = offset + sizeof(frameHeader) + frameHeader.payloadBytes;
+		if (end > m_file.size() || frameHeader.frame != static_cast<unsigned>(m_frameCount))
+			break;
+		if (frameHeader.keyframe)
+			m_keyframes.push_back(TrajectoryIndexEntry{ offset, frameHeader.frame });
+		m_frameCount++;
+		offset = end;
+	}
+}
+
+bool TrajectoryReplay::decodeNext()
+{
+	if (m_nextOffset + sizeof(TrajectoryFrameHeader) > m_file.size())
+		return false;
+	TrajectoryFrameHeader frameHeader;
+	std::memcpy(&frameHeader, m_file.data() + m_nextOffset, sizeof(frameHeader));
+	const unsigned char* payload = m_file.data() + m_nextOffset + sizeof(frameHeader);
+	if (m_nextOffset + sizeof(frameHeader) + frameHeader.payloadBytes > m_file.size())
+		return false;
+
+	// The frame just shown becomes the reference for the next delta
+	std::swap(m_previousFrame, m_frame);
+	m_hasPrevious = m_current >= 0;
+	const bool decoded = frameHeader.keyframe
+		? m_codec.decode(nullptr, payload, frameHeader.payloadBytes, static_cast<int>(frameHeader.fishCount), m_frame)
+		: m_hasPrevious && m_codec.decode(&m_previousFrame, payload, frameHeader.payloadBytes, static_cast<int>(frameHeader.fishCount), m_frame);
+	if (!decoded)
+		return false;
+	if (frameHeader.keyframe)
+	{
+		// Species index the speed ranges, delta frames inherit them from their keyframe
+		for (unsigned char species : m_frame.species)
+		{
+			if (species >= m_header->speciesCount)
+				return false;
+		}
+	}
+	m_current = static_cast<int>(frameHeader.frame);
+	m_nextOffset += sizeof(frameHeader) + frameHeader.payloadBytes;
+	return true;
+}
+
+void TrajectoryReplay::buildFishes()
+{
+	m_fishes.clear();
+	m_fishes.reserve(m_frame.size());
+	for (int i = 0; i < m_frame.size(); i++)
+		m_fishes.push_back(Fish{ TrajectoryCodec::dequantize(m_frame, i), TrajectoryCodec::dequantizeVelocity(m_frame, i, m_maxSpeeds), m_frame.species[i] });
+}
+
+bool TrajectoryReplay::seek(int frame)
+{
+	if (!m_header || frame < 0 || frame >= m_frameCount)
+		return false;
+	if (frame == m_current)
+		return true;
+
+	// Step forward when the target is ahead within the same keyframe span, otherwise jump to its keyframe
+	auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), static_cast<unsigned>(frame),
+		[](unsigned target, const TrajectoryIndexEntry& entry) { return target < entry.frame; });
+	if (keyframe == m_keyframes.begin())
+		return false;
+	--keyframe;
+	if (m_current < 0 || frame < m_current || static_cast<int>(keyframe->frame) > m_current)
+	{
+		m_current = -1;
+		m_nextOffset = keyframe->offset;
+	}
+	while (m_current < frame)
+	{
+		if (!decodeNext())
+			return false;
+	}
+	buildFishes();
+	return true;
+}
+
+void TrajectoryReplay::close()
+{
+	m_file.close();
+	m_header = nullptr;
+	m_maxSpeeds = nullptr;
+	m_keyframes.clear();
+	m_frameCount = 0;
+	m_current = -1;
+	m_hasPrevious = false;
+	m_fishes.clear();
+}
+
+bool TrajectoryReplay::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+int TrajectoryReplay::getFrameCount() const
+{
+	return m_frameCount;
+}
+
+int TrajectoryReplay::getFrame() const
+{
+	return m_current;
+}
+
+const std::vector<Fish>& TrajectoryReplay::getFishes() const
+{
+	return m_fishes;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "raylib.h"
+#include "Fish.h"
+#include "MappedFile.h"
+#include "TrajectoryCodec.h"
+#include <vector>
+
+// Plays a recorded trajectory back from a memory-mapped file. Seeking decodes forward from the
+// closest keyframe at or before the target, found through the index at the end of the file, or by
+// walking the frame headers when the recording was cut short. Decoded frames come out as fish with
+// their recorded velocities, so the viewer draws them through the same path as a live flock without
+// stepping the simulation.
+class TrajectoryReplay
+{
+private:
+	MappedFile m_file;
+	const TrajectoryHeader* m_header{};
+	const float* m_maxSpeeds{};
+	unsigned long long m_framesOffset{};
+	std::vector<TrajectoryIndexEntry> m_keyframes;
+	int m_frameCount{};
+	TrajectoryCodec m_codec;
+	QuantizedFrame m_frame;
+	QuantizedFrame m_previousFrame;
+	bool m_hasPrevious{};
+	int m_current{ -1 };
+	unsigned long long m_nextOffset{};
+	std::vector<Fish> m_fishes;
+
+	bool readIndex();
+	void scanFrames();
+	bool decodeNext();
+	void buildFishes();
+
+public:
+	bool open(const char* path);
+	void close();
+	bool isOpen() const;
+	int getFrameCount() const;
+	int getFrame() const;
+	bool seek(int frame);
+	const std::vector<Fish>& getFishes() const;
+};
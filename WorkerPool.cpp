@@ -0,0 +1,73 @@
+#include "WorkerPool.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+int WorkerPool::getThreadCount() const
+{
+	return static_cast<int>(m_threads.size());
+}
+
+void WorkerPool::work()
+{
+	// A thread that wakes late may find a run already finished or still going,
+	// either way it only takes tasks that are left
+	unsigned long long seen = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+		if (m_stopping)
+			return;
+		seen = m_generation;
+		while (m_nextTask < m_taskCount - 1)
+		{
+			const int task = m_nextTask++;
+			lock.unlock();
+			m_task(m_context, task);
+			lock.lock();
+			if (--m_pending == 0)
+				m_done.notify_one();
+		}
+	}
+}
+
+void WorkerPool::dispatch(void (*task)(void*, int), void* context, int taskCount)
+{
+	if (taskCount <= 0)
+		return;
+	if (taskCount == 1)
+	{
+		task(context, 0);
+		return;
+	}
+	while (static_cast<int>(m_threads.size()) < taskCount - 1)
+		m_threads.emplace_back(&WorkerPool::work, this);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_context = context;
+		m_taskCount = taskCount;
+		m_nextTask = 0;
+		m_pending = taskCount - 1;
+		m_generation++;
+	}
+	m_wake.notify_all();
+	task(context, taskCount - 1);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [&] { return m_pending == 0; });
+}
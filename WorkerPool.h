@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Threads kept alive between steps, so a parallel loop wakes sleeping threads instead of starting
+// new ones. run() hands out tasks 0 to taskCount - 2 to the pool and runs the last one on the calling
+// thread, returning once all of them are done. Threads are started the first time a run needs them,
+// after that dispatching allocates nothing. Only one thread may call run() at a time.
+class WorkerPool
+{
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	void (*m_task)(void*, int) {};
+	void* m_context{};
+	int m_taskCount{};
+	int m_nextTask{};
+	int m_pending{};
+	unsigned long long m_generation{};
+	bool m_stopping{};
+
+	template<typename Task> static void invoke(void* context, int task);
+	void work();
+	void dispatch(void (*task)(void*, int), void* context, int taskCount);
+
+public:
+	WorkerPool() = default;
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+	int getThreadCount() const;
+	template<typename Task> void run(int taskCount, Task& task);
+};
+
+template<typename Task>
+void WorkerPool::invoke(void* context, int task)
+{
+	(*static_cast<Task*>(context))(task);
+}
+
+// Task is called with each index in [0, taskCount), it is referenced rather than copied
+template<typename Task>
+void WorkerPool::run(int taskCount, Task& task)
+{
+	dispatch(&WorkerPool::invoke<Task>, &task, taskCount);
+}